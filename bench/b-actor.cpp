@@ -0,0 +1,106 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <xeq/actor.hpp>
+#include <xeq/context.hpp>
+#include <xeq/executor.hpp>
+#include <xeq/thread_runner.hpp>
+#include <picobench/picobench.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// actors vs a post to the strand for every message
+// ping-pong: two strands bounce a counter until it reaches zero (one message in flight, so no batching)
+// fan-in: several threads send to a single strand (the actor drains the messages in batches)
+
+namespace {
+
+void ping_pong_actor(picobench::state& s) {
+    xeq::context ctx;
+    xeq::actor_ptr<int> ping, pong;
+    ping = xeq::make_actor<int>(ctx.make_strand(), [&](int n) { if (n) pong->send(n - 1); });
+    pong = xeq::make_actor<int>(ctx.make_strand(), [&](int n) { if (n) ping->send(n - 1); });
+
+    picobench::scope scope(s);
+    ping->send(s.iterations());
+    ctx.run();
+}
+
+struct post_player {
+    xeq::strand_ptr strand;
+    post_player* other = nullptr;
+
+    void receive(int n) {
+        if (!n) return;
+        other->strand->post([o = other, n] { o->receive(n - 1); });
+    }
+};
+
+void ping_pong_post(picobench::state& s) {
+    xeq::context ctx;
+    post_player ping{ctx.make_strand()}, pong{ctx.make_strand()};
+    ping.other = &pong;
+    pong.other = &ping;
+
+    picobench::scope scope(s);
+    ping.strand->post([&, n = s.iterations()] { ping.receive(n); });
+    ctx.run();
+}
+
+constexpr int num_senders = 4;
+
+template <typename Send>
+void fan_in(picobench::state& s, xeq::context& ctx, std::atomic_int& received, Send send) {
+    const int per_sender = s.iterations() / num_senders;
+    const int total = per_sender * num_senders;
+
+    auto wg = ctx.make_work_guard();
+    xeq::thread_runner runner;
+    runner.start(ctx, 1);
+
+    {
+        picobench::scope scope(s);
+        std::vector<std::thread> senders;
+        for (int i = 0; i < num_senders; ++i) {
+            senders.emplace_back([&] {
+                for (int j = 0; j < per_sender; ++j) send(j);
+            });
+        }
+        for (auto& t : senders) t.join();
+        while (received.load(std::memory_order_relaxed) != total) std::this_thread::yield();
+    }
+
+    wg.reset();
+    runner.join();
+}
+
+void fan_in_actor(picobench::state& s) {
+    xeq::context ctx;
+    std::atomic_int received = 0;
+    auto a = xeq::make_actor<int>(ctx.make_strand(), [&](int) {
+        received.store(received.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    });
+    fan_in(s, ctx, received, [&](int i) { a->send(i); });
+}
+
+void fan_in_post(picobench::state& s) {
+    xeq::context ctx;
+    std::atomic_int received = 0;
+    auto strand = ctx.make_strand();
+    fan_in(s, ctx, received, [&](int) {
+        strand->post([&] {
+            received.store(received.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        });
+    });
+}
+
+}
+
+PICOBENCH_SUITE("actor ping-pong");
+PICOBENCH(ping_pong_post).baseline();
+PICOBENCH(ping_pong_actor);
+
+PICOBENCH_SUITE("actor fan-in");
+PICOBENCH(fan_in_post).baseline();
+PICOBENCH(fan_in_actor);
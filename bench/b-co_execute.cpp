@@ -0,0 +1,56 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <xeq/co_execute.hpp>
+#include <picobench/picobench.hpp>
+
+// synchronous bridge: co_execute with a reused per-thread context
+// vs a new context per call (what co_execute used to do)
+
+namespace {
+
+xeq::coro<int> leaf(int i) {
+    co_return i;
+}
+
+xeq::coro<int> work(int i) {
+    co_return co_await leaf(i) + co_await leaf(1);
+}
+
+template <typename T>
+T execute_fresh(xeq::coro<T> c) {
+    typename xeq::coro<T>::result_type result = itlib::unexpected();
+    xeq::context ctx;
+    auto guard = ctx.make_work_guard();
+    struct helper {
+        static xeq::coro<void> run(xeq::coro<T> c, typename xeq::coro<T>::result_type& result, xeq::work_guard& guard) {
+            result = co_await c.safe_result();
+            guard.reset();
+        }
+    };
+    xeq::co_spawn(ctx, helper::run(std::move(c), result, guard));
+    ctx.run();
+    return std::move(result).value();
+}
+
+void fresh_context(picobench::state& s) {
+    int sum = 0;
+    for (auto i : s) {
+        sum += execute_fresh(work(i));
+    }
+    s.set_result(sum);
+}
+
+void reused_context(picobench::state& s) {
+    int sum = 0;
+    for (auto i : s) {
+        sum += xeq::co_execute(work(i));
+    }
+    s.set_result(sum);
+}
+
+}
+
+PICOBENCH_SUITE("co_execute");
+PICOBENCH(fresh_context).baseline();
+PICOBENCH(reused_context);
@@ -0,0 +1,112 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <xeq/typed_executor.hpp>
+#include <xeq/context.hpp>
+#include <xeq/co_spawn.hpp>
+#include <xeq/executor.hpp>
+#include <picobench/picobench.hpp>
+
+// the type-erased executor_ptr (virtual calls) vs the statically typed handles (inlined asio calls)
+// post: post all handlers, then run them
+// co_spawn: spawn trivial coroutines, then run them
+// running_in_this_thread: the call alone, as it's often on the hot path of wait objects
+
+namespace {
+
+template <typename Ex>
+void post_n(picobench::state& s, xeq::context& ctx, const Ex& ex) {
+    int sum = 0;
+    {
+        picobench::scope scope(s);
+        for (int i = 0; i < s.iterations(); ++i) {
+            xeq::post(ex, [&sum] { ++sum; });
+        }
+        ctx.run();
+    }
+    s.set_result(sum);
+}
+
+void post_erased(picobench::state& s) {
+    xeq::context ctx;
+    post_n(s, ctx, ctx.get_executor());
+}
+
+void post_typed(picobench::state& s) {
+    xeq::context ctx;
+    post_n(s, ctx, xeq::context_executor_ref(ctx));
+}
+
+void post_strand_erased(picobench::state& s) {
+    xeq::context ctx;
+    post_n(s, ctx, ctx.make_strand());
+}
+
+void post_strand_typed(picobench::state& s) {
+    xeq::context ctx;
+    post_n(s, ctx, xeq::context_strand(ctx));
+}
+
+xeq::coro<void> inc(int& sum) {
+    ++sum;
+    co_return;
+}
+
+template <typename Ex>
+void spawn_n(picobench::state& s, xeq::context& ctx, const Ex& ex) {
+    int sum = 0;
+    {
+        picobench::scope scope(s);
+        for (int i = 0; i < s.iterations(); ++i) {
+            xeq::co_spawn(ex, inc(sum));
+        }
+        ctx.run();
+    }
+    s.set_result(sum);
+}
+
+void co_spawn_erased(picobench::state& s) {
+    xeq::context ctx;
+    spawn_n(s, ctx, ctx.get_executor());
+}
+
+void co_spawn_typed(picobench::state& s) {
+    xeq::context ctx;
+    spawn_n(s, ctx, xeq::context_executor_ref(ctx));
+}
+
+void running_erased(picobench::state& s) {
+    xeq::context ctx;
+    const xeq::executor_ptr& ex = ctx.get_executor();
+    int n = 0;
+    for (auto _ : s) {
+        n += ex->running_in_this_thread();
+    }
+    s.set_result(n);
+}
+
+void running_typed(picobench::state& s) {
+    xeq::context ctx;
+    xeq::context_executor_ref ex(ctx);
+    int n = 0;
+    for (auto _ : s) {
+        n += ex.running_in_this_thread();
+    }
+    s.set_result(n);
+}
+
+}
+
+PICOBENCH_SUITE("devirtualize post");
+PICOBENCH(post_erased).baseline();
+PICOBENCH(post_typed);
+PICOBENCH(post_strand_erased);
+PICOBENCH(post_strand_typed);
+
+PICOBENCH_SUITE("devirtualize co_spawn");
+PICOBENCH(co_spawn_erased).baseline();
+PICOBENCH(co_spawn_typed);
+
+PICOBENCH_SUITE("devirtualize running_in_this_thread");
+PICOBENCH(running_erased).baseline();
+PICOBENCH(running_typed);
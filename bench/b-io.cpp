@@ -0,0 +1,138 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <xeq/context.hpp>
+#include <picobench/picobench.hpp>
+
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/post.hpp>
+
+#if defined(BOOST_ASIO_HAS_FILE)
+#include <boost/asio/random_access_file.hpp>
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+
+// the asio backend is selected when building xeq (XEQ_IO_URING cmake option)
+// build once with each and compare the results
+
+namespace asio = boost::asio;
+
+namespace {
+
+const int print_backend = std::printf("xeq backend: %s\n", xeq::context::backend_name());
+
+struct ping_pong {
+    asio::posix::stream_descriptor a_out, b_in, b_out, a_in;
+    char a_byte = 'x', b_byte = 0;
+    int remaining;
+
+    ping_pong(asio::io_context& ctx, int iterations)
+        : a_out(ctx), b_in(ctx), b_out(ctx), a_in(ctx)
+        , remaining(iterations)
+    {
+        int ab[2], ba[2];
+        if (pipe(ab) || pipe(ba)) std::abort();
+        b_in.assign(ab[0]);
+        a_out.assign(ab[1]);
+        a_in.assign(ba[0]);
+        b_out.assign(ba[1]);
+    }
+
+    void a_send() {
+        asio::async_write(a_out, asio::buffer(&a_byte, 1), [this](auto ec, size_t) {
+            if (ec) return;
+            asio::async_read(a_in, asio::buffer(&a_byte, 1), [this](auto ec, size_t) {
+                if (ec) return;
+                if (--remaining > 0) a_send();
+                else b_in.close(); // stop the echo
+            });
+        });
+    }
+
+    void b_echo() {
+        asio::async_read(b_in, asio::buffer(&b_byte, 1), [this](auto ec, size_t) {
+            if (ec) return;
+            asio::async_write(b_out, asio::buffer(&b_byte, 1), [this](auto ec, size_t) {
+                if (ec) return;
+                b_echo();
+            });
+        });
+    }
+};
+
+void pipe_ping_pong(picobench::state& s) {
+    xeq::context ctx;
+    ping_pong pp(ctx.as_asio_io_context(), s.iterations());
+    picobench::scope scope(s);
+    pp.b_echo();
+    pp.a_send();
+    ctx.run();
+}
+
+constexpr size_t file_chunk = 4096;
+constexpr size_t file_chunks = 256;
+
+struct temp_file {
+    char path[32] = "/tmp/xeq-bench-XXXXXX";
+    temp_file() {
+        int fd = mkstemp(path);
+        if (fd < 0) std::abort();
+        std::vector<char> data(file_chunk * file_chunks, 'x');
+        if (write(fd, data.data(), data.size()) != ssize_t(data.size())) std::abort();
+        close(fd);
+    }
+    ~temp_file() {
+        unlink(path);
+    }
+};
+
+void file_read(picobench::state& s) {
+    temp_file tf;
+    xeq::context ctx;
+    std::vector<char> buf(file_chunk);
+    int remaining = s.iterations();
+
+#if defined(BOOST_ASIO_HAS_FILE)
+    asio::random_access_file f(ctx.as_asio_io_context(), tf.path, asio::random_access_file::read_only);
+    auto read_one = [&](auto& self) -> void {
+        auto offset = (remaining % file_chunks) * file_chunk;
+        f.async_read_some_at(offset, asio::buffer(buf), [&](auto ec, size_t) {
+            if (ec) return;
+            if (--remaining > 0) self(self);
+        });
+    };
+#else
+    // no async files with this backend: blocking reads on the context as a baseline
+    int fd = open(tf.path, O_RDONLY);
+    auto read_one = [&](auto& self) -> void {
+        asio::post(ctx.as_asio_io_context(), [&] {
+            auto offset = (remaining % file_chunks) * file_chunk;
+            if (pread(fd, buf.data(), buf.size(), offset) < 0) return;
+            if (--remaining > 0) self(self);
+        });
+    };
+#endif
+
+    {
+        picobench::scope scope(s);
+        read_one(read_one);
+        ctx.run();
+    }
+
+#if !defined(BOOST_ASIO_HAS_FILE)
+    close(fd);
+#endif
+}
+
+}
+
+PICOBENCH_SUITE("io");
+PICOBENCH(pipe_ping_pong);
+PICOBENCH(file_read);
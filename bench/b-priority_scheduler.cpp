@@ -0,0 +1,73 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <xeq/priority_scheduler.hpp>
+#include <xeq/context.hpp>
+#include <xeq/executor.hpp>
+#include <picobench/picobench.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// latency of a critical handler posted behind a burst of bulk work on the same context
+// the time is for the entire mixed workload, p99 of the critical latency is printed separately
+
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+constexpr int bulk_per_critical = 32;
+
+void spin(std::chrono::nanoseconds d) {
+    auto end = clock_type::now() + d;
+    while (clock_type::now() < end);
+}
+
+void print_p99(const char* name, std::vector<clock_type::duration>& lat) {
+    std::sort(lat.begin(), lat.end());
+    auto p99 = lat[lat.size() * 99 / 100];
+    std::printf("%s: critical p99 latency: %lld ns (%zu samples)\n", name,
+        (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(p99).count(), lat.size());
+}
+
+template <typename PostBulk, typename PostCritical>
+void mixed_load(picobench::state& s, xeq::context& ctx, PostBulk post_bulk, PostCritical post_critical, const char* name) {
+    std::vector<clock_type::duration> lat;
+    lat.reserve(s.iterations());
+
+    for (auto _ : s) {
+        for (int i = 0; i < bulk_per_critical; ++i) {
+            post_bulk([] { spin(std::chrono::microseconds(1)); });
+        }
+        auto posted = clock_type::now();
+        post_critical([&lat, posted] { lat.push_back(clock_type::now() - posted); });
+        ctx.run();
+        ctx.restart();
+    }
+
+    print_p99(name, lat);
+}
+
+void fifo(picobench::state& s) {
+    xeq::context ctx;
+    auto& ex = ctx.get_executor();
+    auto post = [&](auto f) { ex->post(std::move(f)); };
+    mixed_load(s, ctx, post, post, "fifo");
+}
+
+void priority(picobench::state& s) {
+    xeq::context ctx;
+    auto ps = xeq::priority_scheduler::create(ctx);
+    mixed_load(s, ctx,
+        [&](auto f) { ps->post(2, std::move(f)); },
+        [&](auto f) { ps->post(0, std::move(f)); },
+        "priority"
+    );
+}
+
+}
+
+PICOBENCH_SUITE("mixed load");
+PICOBENCH(fifo).baseline();
+PICOBENCH(priority);
@@ -0,0 +1,213 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <xeq/spsc_channel.hpp>
+#include <xeq/simple_wobj.hpp>
+#include <xeq/context.hpp>
+#include <xeq/co_spawn.hpp>
+#include <xeq/thread_runner.hpp>
+#include <picobench/picobench.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a producer thread feeding a consumer coroutine on a strand of another thread
+// spsc_channel vs the mutex-plus-simple_wobj pattern (a vector under a mutex and a notify on the empty->non-empty edge)
+// throughput: the time to move all values, pushed one by one or in batches
+// latency: the time from a push to an idle consumer until it has the value. The percentiles are printed separately
+
+using clock_type = std::chrono::steady_clock;
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr size_t batch_size = 64;
+
+struct ring_pipe {
+    xeq::spsc_channel<int> ch;
+
+    explicit ring_pipe(const xeq::strand_ptr& s) : ch(s, 1024) {}
+
+    void push(int v) {
+        while (!ch.try_push(v)) std::this_thread::yield();
+    }
+
+    void push_n(const int* begin, const int* end) {
+        while ((begin = ch.try_push_n(begin, end)) != end) std::this_thread::yield();
+    }
+
+    void close() {
+        ch.close();
+    }
+
+    template <typename F>
+    xeq::coro<void> consume(F f) {
+        int batch[batch_size];
+        while (co_await ch.wait()) {
+            while (auto n = ch.try_pop_n(batch, batch_size)) {
+                for (size_t i = 0; i < n; ++i) f(batch[i]);
+            }
+        }
+    }
+};
+
+struct mutex_pipe {
+    std::mutex mutex;
+    std::vector<int> queue;
+    bool closed = false;
+    xeq::simple_wobj wobj;
+
+    explicit mutex_pipe(const xeq::strand_ptr& s) : wobj(s) {}
+
+    void push(int v) {
+        push_n(&v, &v + 1);
+    }
+
+    void push_n(const int* begin, const int* end) {
+        bool wake;
+        {
+            std::lock_guard l(mutex);
+            wake = queue.empty();
+            queue.insert(queue.end(), begin, end);
+        }
+        if (wake) wobj.notify_one();
+    }
+
+    void close() {
+        {
+            std::lock_guard l(mutex);
+            closed = true;
+        }
+        wobj.notify_one();
+    }
+
+    template <typename F>
+    xeq::coro<void> consume(F f) {
+        std::vector<int> batch;
+        while (true) {
+            bool done;
+            {
+                std::lock_guard l(mutex);
+                batch.swap(queue);
+                done = closed;
+            }
+            for (auto v : batch) f(v);
+            if (!batch.empty()) {
+                batch.clear();
+                continue;
+            }
+            if (done) break;
+            co_await wobj.wait();
+        }
+    }
+};
+
+xeq::coro<void> consume_then_release(xeq::coro<void> c, xeq::work_guard& wg) {
+    co_await std::move(c);
+    wg.reset();
+}
+
+template <typename Pipe>
+void throughput(picobench::state& s, bool batched) {
+    xeq::context ctx;
+    auto wg = ctx.make_work_guard();
+    auto strand = ctx.make_strand();
+    Pipe pipe(strand);
+
+    uint64_t sum = 0;
+    xeq::co_spawn(strand, consume_then_release(pipe.consume([&](int v) { sum += v; }), wg));
+
+    std::vector<int> values(s.iterations());
+    for (size_t i = 0; i < values.size(); ++i) values[i] = int(i);
+
+    xeq::thread_runner runner;
+    {
+        picobench::scope scope(s);
+        runner.start(ctx, 1);
+        auto p = values.data();
+        const auto end = p + values.size();
+        if (batched) {
+            while (p != end) {
+                auto next = std::min(p + batch_size, end);
+                pipe.push_n(p, next);
+                p = next;
+            }
+        }
+        else {
+            for (; p != end; ++p) pipe.push(*p);
+        }
+        pipe.close();
+        runner.join();
+    }
+    s.set_result(uintptr_t(sum));
+}
+
+void ring(picobench::state& s) { throughput<ring_pipe>(s, false); }
+void ring_batched(picobench::state& s) { throughput<ring_pipe>(s, true); }
+void mutex_wobj(picobench::state& s) { throughput<mutex_pipe>(s, false); }
+void mutex_wobj_batched(picobench::state& s) { throughput<mutex_pipe>(s, true); }
+
+constexpr auto gap = 50us;
+
+void spin(std::chrono::nanoseconds d) {
+    auto end = clock_type::now() + d;
+    while (clock_type::now() < end);
+}
+
+template <typename Pipe>
+void latency(picobench::state& s, const char* name) {
+    std::vector<clock_type::duration> lat;
+    lat.reserve(s.iterations());
+
+    xeq::context ctx;
+    auto wg = ctx.make_work_guard();
+    auto strand = ctx.make_strand();
+    Pipe pipe(strand);
+
+    std::atomic_bool received;
+    clock_type::time_point at;
+    xeq::co_spawn(strand, consume_then_release(pipe.consume([&](int) {
+        at = clock_type::now();
+        received.store(true, std::memory_order_release);
+    }), wg));
+
+    xeq::thread_runner runner;
+    runner.start(ctx, 1);
+
+    for (auto i : s) {
+        spin(gap);
+        received = false;
+        auto pushed = clock_type::now();
+        pipe.push(i);
+        while (!received.load(std::memory_order_acquire));
+        lat.push_back(at - pushed);
+    }
+
+    pipe.close();
+    runner.join();
+
+    std::sort(lat.begin(), lat.end());
+    auto ns = [&](size_t p) {
+        return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(lat[lat.size() * p / 100]).count();
+    };
+    std::printf("%s: latency p50: %lld ns, p99: %lld ns\n", name, ns(50), ns(99));
+}
+
+void ring_latency(picobench::state& s) { latency<ring_pipe>(s, "ring"); }
+void mutex_wobj_latency(picobench::state& s) { latency<mutex_pipe>(s, "mutex + simple_wobj"); }
+
+}
+
+PICOBENCH_SUITE("spsc throughput");
+PICOBENCH(mutex_wobj).baseline();
+PICOBENCH(ring);
+PICOBENCH(mutex_wobj_batched);
+PICOBENCH(ring_batched);
+
+PICOBENCH_SUITE("spsc latency");
+PICOBENCH(mutex_wobj_latency).baseline();
+PICOBENCH(ring_latency);
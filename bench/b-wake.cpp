@@ -0,0 +1,85 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <xeq/context.hpp>
+#include <xeq/executor.hpp>
+#include <xeq/thread_runner.hpp>
+#include <picobench/picobench.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// wake latency: time from a post to an idle context until the handler runs on its thread
+// the poster waits for a gap between posts, so the context is idle every time
+// the time is for the entire workload (including the gaps), percentiles of the wake latency are printed separately
+
+using clock_type = std::chrono::steady_clock;
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr auto gap = 50us;
+
+void spin(std::chrono::nanoseconds d) {
+    auto end = clock_type::now() + d;
+    while (clock_type::now() < end);
+}
+
+template <typename Start>
+void wake(picobench::state& s, Start start, const char* name) {
+    std::vector<clock_type::duration> lat;
+    lat.reserve(s.iterations());
+
+    xeq::context ctx;
+    auto wg = ctx.make_work_guard();
+    xeq::thread_runner runner;
+    start(runner, ctx);
+
+    std::atomic_bool done;
+    clock_type::time_point ran;
+    for (auto _ : s) {
+        spin(gap);
+        done = false;
+        auto posted = clock_type::now();
+        ctx.get_executor()->post([&] {
+            ran = clock_type::now();
+            done.store(true, std::memory_order_release);
+        });
+        while (!done.load(std::memory_order_acquire));
+        lat.push_back(ran - posted);
+    }
+
+    wg.reset();
+    runner.join();
+
+    std::sort(lat.begin(), lat.end());
+    auto ns = [&](size_t p) {
+        return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(lat[lat.size() * p / 100]).count();
+    };
+    auto stats = ctx.get_spin_stats();
+    std::printf("%s: wake latency p50: %lld ns, p99: %lld ns, spin hits: %llu, parks: %llu\n", name,
+        ns(50), ns(99), (unsigned long long)stats.spin_hits, (unsigned long long)stats.parks);
+}
+
+void run(picobench::state& s) {
+    wake(s, [](xeq::thread_runner& r, xeq::context& ctx) { r.start(ctx, 1); }, "run");
+}
+
+// budget shorter than the gap: parks every time, shows the overhead of spinning in vain
+void spin_short(picobench::state& s) {
+    wake(s, [](xeq::thread_runner& r, xeq::context& ctx) { r.start_spin(ctx, 1, 10us); }, "spin 10us");
+}
+
+// budget longer than the gap: never parks
+void spin_long(picobench::state& s) {
+    wake(s, [](xeq::thread_runner& r, xeq::context& ctx) { r.start_spin(ctx, 1, 200us); }, "spin 200us");
+}
+
+}
+
+PICOBENCH_SUITE("wake");
+PICOBENCH(run).baseline();
+PICOBENCH(spin_short);
+PICOBENCH(spin_long);
@@ -0,0 +1,159 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "executor.hpp"
+#include <itlib/shared_from.hpp>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace xeq {
+
+// actors: a typed mailbox bound to a strand
+//
+// auto counter = make_actor<int>(ctx.make_strand(), [sum = 0](int n) mutable { sum += n; });
+// counter->send(5); // from any thread
+//
+// the handler is called on the strand with every message as an rvalue, in send order for every sender
+// sends are lock-free and the actor is scheduled with a single post when its mailbox becomes non-empty,
+// then one run drains up to batch_size messages before it yields the strand (and reschedules itself if more remain)
+// make_actor allocates the actor, its handler and the shared_ptr control block together
+// every message is a node allocated by send
+//
+// the actor stays alive while it's scheduled, even if all other references to it are released
+// (thus an actor which is scheduled on a context that is destroyed without running it is leaked)
+// messages which are still in the mailbox when it's destroyed are destroyed without being handled
+// if the handler throws, the exception propagates out of the strand and the actor is rescheduled as usual
+
+template <typename Msg>
+class actor : public itlib::enable_shared_from {
+public:
+    actor(const actor&) = delete;
+    actor& operator=(const actor&) = delete;
+
+    const strand_ptr& get_strand() const noexcept { return m_strand; }
+
+    template <typename... Args>
+    void send(Args&&... args) {
+        auto n = new node{Msg(std::forward<Args>(args)...), m_inbox.load(std::memory_order_relaxed)};
+        while (!m_inbox.compare_exchange_weak(n->next, n));
+        if (!m_scheduled.exchange(true)) {
+            // we are the only writer until the run takes it
+            m_keepalive = shared_from(this);
+            m_strand->post_call(m_run, this);
+        }
+    }
+
+protected:
+    struct node {
+        Msg msg;
+        node* next;
+    };
+
+    using run_func = void (*)(void*);
+
+    actor(strand_ptr strand, size_t batch_size, run_func run)
+        : m_strand(std::move(strand))
+        , m_batch_size(batch_size ? batch_size : 1)
+        , m_run(run)
+    {}
+
+    ~actor() {
+        delete_list(m_pending);
+        delete_list(m_inbox.load());
+    }
+
+    // called by the run on the strand
+    // returns null if there are no messages
+    node* next_message() noexcept {
+        if (!m_pending) {
+            // the inbox is a stack, so reverse it to get the send order
+            auto n = m_inbox.exchange(nullptr);
+            while (n) {
+                auto next = n->next;
+                n->next = m_pending;
+                m_pending = n;
+                n = next;
+            }
+        }
+        return std::exchange(m_pending, m_pending ? m_pending->next : nullptr);
+    }
+
+    // returns the keepalive reference which is to be released after the run (and after the actor is last touched)
+    std::shared_ptr<actor> take_keepalive() noexcept {
+        return std::move(m_keepalive);
+    }
+
+    // called at the end of a run
+    void yield(std::shared_ptr<actor>& self) {
+        m_scheduled.store(false);
+        if ((m_pending || m_inbox.load()) && !m_scheduled.exchange(true)) {
+            m_keepalive = std::move(self);
+            m_strand->post_call(m_run, this);
+        }
+    }
+
+    size_t batch_size() const noexcept { return m_batch_size; }
+
+private:
+    static void delete_list(node* n) noexcept {
+        while (n) {
+            delete std::exchange(n, n->next);
+        }
+    }
+
+    const strand_ptr m_strand;
+    const size_t m_batch_size;
+    const run_func m_run;
+
+    // seq_cst (the default): a run which unschedules itself must see the last send
+    // or the sender must see it unscheduled
+    std::atomic<node*> m_inbox = nullptr; // pushed by senders, taken whole by the run
+    std::atomic_bool m_scheduled = false;
+    std::shared_ptr<actor> m_keepalive; // set by the sender which schedules the run
+
+    // only touched on the strand
+    node* m_pending = nullptr; // in send order
+};
+
+template <typename Msg>
+using actor_ptr = std::shared_ptr<actor<Msg>>;
+
+namespace impl {
+template <typename Msg, typename Handler>
+class actor_impl final : public actor<Msg> {
+public:
+    actor_impl(strand_ptr strand, Handler&& handler, size_t batch_size)
+        : actor<Msg>(std::move(strand), batch_size, run)
+        , m_handler(std::move(handler))
+    {}
+
+private:
+    Handler m_handler;
+
+    static void run(void* p) {
+        auto& self = *static_cast<actor_impl*>(p);
+        auto keepalive = self.take_keepalive();
+        struct yield_guard {
+            actor_impl& self;
+            std::shared_ptr<actor<Msg>>& keepalive;
+            ~yield_guard() { self.yield(keepalive); }
+        } yg{self, keepalive};
+
+        for (size_t i = 0; i < self.batch_size(); ++i) {
+            std::unique_ptr<typename actor<Msg>::node> n(self.next_message());
+            if (!n) break;
+            self.m_handler(std::move(n->msg));
+        }
+    }
+};
+}
+
+template <typename Msg, typename Handler>
+actor_ptr<Msg> make_actor(strand_ptr strand, Handler handler, size_t batch_size = 64) {
+    return std::make_shared<impl::actor_impl<Msg, Handler>>(std::move(strand), std::move(handler), batch_size);
+}
+
+} // namespace xeq
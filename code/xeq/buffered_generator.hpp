@@ -0,0 +1,205 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "coro.hpp"
+#include "co_spawn.hpp"
+#include "executor.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace xeq {
+
+// run a generator ahead of its consumer
+//
+// auto g = buffered(decode(file), decoder_strand, 16);
+// co_for (frame, std::move(g)) { ... }
+//
+// the source generator is driven by a producer coroutine which is spawned on the given executor immediately
+// produced values go into a bounded single-producer single-consumer ring and the returned generator yields
+// them on the consumer's executor. Thus a slow producer and a slow consumer run in parallel
+// when the ring is full, the producer is suspended until the consumer frees a slot (backpressure)
+//
+// the ring is lock-free. Only a side which has to suspend (producer on full, consumer on empty)
+// takes a lock to park itself
+// exceptions and the return value of the source are delivered after the buffered values
+// destroying the returned generator stops the producer (after the value it's currently producing, if any)
+
+namespace impl {
+
+template <typename Gen, typename Ret>
+class buffered_gen_state {
+public:
+    explicit buffered_gen_state(size_t capacity)
+        : m_slots(capacity ? capacity : 1)
+    {}
+
+    using source_t = generator<Gen, Ret>;
+
+    static coro<void> produce(std::shared_ptr<buffered_gen_state> self, source_t src) {
+        auto& s = *self;
+        while (true) {
+            co_await s.park(s.m_producer, [&] { return !s.full() || s.m_cancelled.load(); });
+            if (s.m_cancelled.load()) co_return;
+
+            std::optional<itlib::expected<Gen, Ret>> v;
+            try {
+                v.emplace(co_await src.next());
+            }
+            catch (...) {
+                s.m_result = itlib::unexpected(std::current_exception());
+                break;
+            }
+
+            if (!*v) {
+                if constexpr (std::is_void_v<Ret>) {
+                    s.m_result = coro_result<void>();
+                }
+                else {
+                    s.m_result = std::move(*v).error();
+                }
+                break;
+            }
+
+            const auto h = s.m_head.load();
+            s.m_slots[h % s.m_slots.size()].emplace(std::move(**v));
+            s.m_head.store(h + 1);
+            s.wake(s.m_consumer);
+        }
+        s.m_finished.store(true);
+        s.wake(s.m_consumer);
+    }
+
+    // stops the producer when the consumer is destroyed (even if it never started)
+    class consumer_guard {
+    public:
+        explicit consumer_guard(std::shared_ptr<buffered_gen_state> s) noexcept : m_state(std::move(s)) {}
+        consumer_guard(consumer_guard&&) noexcept = default;
+        ~consumer_guard() {
+            if (!m_state) return;
+            {
+                // the consumer may be destroyed while parked: don't let the producer resume it
+                std::lock_guard l(m_state->m_park_mutex);
+                auto& c = m_state->m_consumer;
+                c.parked.store(false);
+                c.handle = nullptr;
+                c.ex.reset();
+            }
+            m_state->m_cancelled.store(true);
+            m_state->wake(m_state->m_producer);
+        }
+    private:
+        std::shared_ptr<buffered_gen_state> m_state;
+    };
+
+    static source_t consume(std::shared_ptr<buffered_gen_state> self, consumer_guard) {
+        auto& s = *self;
+        while (true) {
+            co_await s.park(s.m_consumer, [&] { return !s.empty() || s.m_finished.load(); });
+            if (s.empty()) break; // finished (and it was set after the last value was pushed)
+
+            const auto t = s.m_tail.load();
+            auto& slot = s.m_slots[t % s.m_slots.size()];
+            Gen v = std::move(*slot);
+            slot.reset();
+            s.m_tail.store(t + 1);
+            s.wake(s.m_producer);
+            co_yield std::move(v);
+        }
+
+        if (!s.m_result) {
+            std::rethrow_exception(s.m_result.error());
+        }
+        if constexpr (!std::is_void_v<Ret>) {
+            co_return std::move(s.m_result).value();
+        }
+    }
+
+private:
+    // the ring, indices only grow
+    // seq_cst (the default) on the indices and park flags: a side which parks must see the other's last store
+    // or the other side must see it parked
+    std::vector<std::optional<Gen>> m_slots;
+    std::atomic_size_t m_head = 0; // written by the producer
+    std::atomic_size_t m_tail = 0; // written by the consumer
+
+    bool empty() const noexcept { return m_tail.load() == m_head.load(); }
+    bool full() const noexcept { return m_head.load() - m_tail.load() == m_slots.size(); }
+
+    std::atomic_bool m_finished = false;
+    std::atomic_bool m_cancelled = false;
+    coro_result<Ret> m_result = itlib::unexpected(); // set by the producer before m_finished
+
+    struct waiter {
+        std::atomic_bool parked = false;
+        std::coroutine_handle<> handle;
+        executor_ptr ex;
+    };
+    std::mutex m_park_mutex;
+    waiter m_producer;
+    waiter m_consumer;
+
+    template <typename Cond>
+    struct park_awaitable {
+        buffered_gen_state& s;
+        waiter& w;
+        Cond cond;
+
+        bool await_ready() { return cond(); }
+
+        template <typename PromiseType>
+        bool await_suspend(std::coroutine_handle<PromiseType> h) {
+            std::lock_guard l(s.m_park_mutex);
+            w.handle = h;
+            w.ex = h.promise().m_executor;
+            w.parked.store(true);
+            if (cond()) {
+                // the other side got here first
+                w.parked.store(false);
+                w.handle = nullptr;
+                w.ex.reset();
+                return false;
+            }
+            // don't touch this from here on: we may be resumed as soon as the lock is released
+            return true;
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    template <typename Cond>
+    park_awaitable<Cond> park(waiter& w, Cond cond) {
+        return {*this, w, std::move(cond)};
+    }
+
+    void wake(waiter& w) {
+        if (!w.parked.load()) return;
+        std::coroutine_handle<> h;
+        executor_ptr ex;
+        {
+            std::lock_guard l(m_park_mutex);
+            if (!w.parked.load()) return;
+            w.parked.store(false);
+            h = std::exchange(w.handle, nullptr);
+            ex = std::move(w.ex);
+        }
+        ex->post_resume(h);
+    }
+};
+
+} // namespace impl
+
+template <typename Gen, typename Ret>
+[[nodiscard]] generator<Gen, Ret> buffered(generator<Gen, Ret> g, const executor_ptr& producer, size_t capacity) {
+    static_assert(!std::is_reference_v<Gen>, "buffered generators must yield values, not references");
+    using state = impl::buffered_gen_state<Gen, Ret>;
+    auto s = std::make_shared<state>(capacity);
+    co_spawn(producer, state::produce(s, std::move(g)));
+    return state::consume(s, typename state::consumer_guard(s));
+}
+
+} // namespace xeq
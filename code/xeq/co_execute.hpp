@@ -5,9 +5,73 @@
 #include "co_spawn.hpp"
 #include "context.hpp"
 #include "work_guard.hpp"
+#include <memory>
 
 namespace xeq {
 
+namespace impl {
+// co_execute reuses a context per thread instead of creating a new one for every call
+// it's reset after every call (see context::reset), so one call can't affect the next
+// a nested call (co_execute from a handler of an outer one) gets a fresh context, as the cached one is busy
+class execute_context {
+public:
+    execute_context() {
+        auto& c = cache();
+        if (c.busy) {
+            m_own = std::make_unique<context>();
+            m_ctx = m_own.get();
+            return;
+        }
+        if (!c.ctx) {
+            c.ctx = std::make_unique<context>();
+        }
+        else {
+            c.ctx->restart();
+        }
+        c.busy = true;
+        m_ctx = c.ctx.get();
+    }
+
+    ~execute_context() {
+        if (m_own) return;
+        auto& c = cache();
+        c.busy = false;
+        // if run threw or the context was stopped, it may still have pending work, so don't reuse it
+        if (!m_finished || !c.ctx->reset()) {
+            c.ctx.reset();
+        }
+    }
+
+    execute_context(const execute_context&) = delete;
+    execute_context& operator=(const execute_context&) = delete;
+
+    context& get() noexcept { return *m_ctx; }
+
+    size_t run() {
+        auto ret = m_ctx->run();
+        m_finished = true;
+        return ret;
+    }
+
+private:
+    struct thread_cache {
+        std::unique_ptr<context> ctx;
+        bool busy = false;
+    };
+    static thread_cache& cache() noexcept {
+        static thread_local thread_cache c;
+        return c;
+    }
+
+    context* m_ctx;
+    std::unique_ptr<context> m_own;
+    bool m_finished = false;
+};
+} // namespace impl
+
+// run a coroutine to completion on the calling thread
+// as with a context which is destroyed when the call returns, the executors of the context which runs it
+// must not be used after that (the context is reused by subsequent calls on the same thread)
 template <typename T>
 T co_execute(coro<T> c) {
 
@@ -27,9 +91,9 @@ T co_execute(coro<T> c) {
         }
     };
 
-    context ctx;
-    execute_helper helper(std::move(c), ctx);
-    co_spawn(ctx, helper.run());
+    impl::execute_context ctx;
+    execute_helper helper(std::move(c), ctx.get());
+    co_spawn(ctx.get(), helper.run());
     ctx.run();
 
     if (helper.result) {
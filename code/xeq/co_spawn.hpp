@@ -18,4 +18,14 @@ inline void co_spawn(context& ctx, coro<void> c) {
     co_spawn(ctx.get_executor(), std::move(c));
 }
 
+// for typed executors (see typed_executor.hpp)
+// the coroutine stores the type-erased executor, but the first resume is posted directly
+template <typename TypedExecutor>
+    requires requires(const TypedExecutor& ex) { ex.get_executor(); ex.post_resume(std::coroutine_handle<>{}); }
+void co_spawn(const TypedExecutor& ex, coro<void> c) {
+    auto h = c.take_handle();
+    h.promise().m_executor = ex.get_executor();
+    ex.post_resume(h);
+}
+
 } // namespace xeq
@@ -6,6 +6,9 @@
 #include "executor_ptr.hpp"
 #include "work_guard.hpp"
 #include <string_view>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 
 namespace boost::asio {
 class io_context;
@@ -13,6 +16,9 @@ class io_context;
 
 namespace xeq {
 
+class memory_account;
+using memory_account_ptr = std::shared_ptr<memory_account>;
+
 class XEQ_API context {
 public:
     context();
@@ -25,24 +31,141 @@ public:
     size_t run();
     size_t poll();
 
+    // low-latency run mode: when there are no ready handlers, keep polling (with cpu pause instructions)
+    // for spin_budget and only then block until the next handler
+    // a blocked thread has to be woken up by the OS, which takes microseconds. This trades cpu time for latency
+    // and only makes sense if the spinning thread has a core of its own
+    // like run, returns when the context is stopped or runs out of work
+    size_t run_spin(std::chrono::nanoseconds spin_budget);
+
+    struct spin_stats {
+        uint64_t spin_hits; // times a handler was found while spinning
+        uint64_t parks; // times the spin budget ran out and the thread blocked
+    };
+    spin_stats get_spin_stats() const noexcept;
+
+    // how late timer expirations run their wait callbacks compared to the expiry
+    // lateness which grows under load is a direct sign of a saturated context
+    // recorded for the timers whose executor runs on this context (custom executors which use it as their asio context too)
+    struct timer_stats {
+        using duration = std::chrono::nanoseconds;
+        using time_point = std::chrono::steady_clock::time_point;
+
+        // bucket 0: less than 1us late, bucket i: [2^(i-1), 2^i) us late, the last bucket also has everything later
+        static constexpr size_t num_buckets = 24;
+        uint64_t buckets[num_buckets];
+
+        uint64_t count; // recorded expirations (cancelled waits are not recorded)
+        duration total;
+        duration max;
+
+        struct offender {
+            duration lateness;
+            time_point expiry;
+            const char* label; // see timer::set_label
+        };
+        static constexpr size_t max_offenders = 8;
+        offender worst[max_offenders]; // sorted, the latest first
+        size_t num_worst;
+
+        duration mean() const noexcept {
+            return count ? total / int64_t(count) : duration{};
+        }
+
+        // upper bound of the bucket which contains the p-th percentile (p in [0, 1])
+        duration percentile(double p) const noexcept {
+            if (!count) return {};
+            const auto target = std::min(uint64_t(p * double(count)), count - 1);
+            uint64_t sum = 0;
+            for (size_t i = 0; i < num_buckets - 1; ++i) {
+                sum += buckets[i];
+                if (sum > target) return std::chrono::microseconds(1ull << i);
+            }
+            return max;
+        }
+    };
+    timer_stats get_timer_stats() const noexcept;
+    void reset_timer_stats() noexcept;
+
     void stop();
     bool stopped() const;
     void restart();
 
+    // restore the state of a new context, so that it can be reused for unrelated work (as co_execute does)
+    // detaches all objects, clears the local storage, bounds and memory account of the executor and the timer stats
+    // returns false if the context has been stopped with stop(), as it may have pending work (don't reuse it then)
+    // must not be called while the context is running
+    bool reset();
+
     [[nodiscard]] work_guard make_work_guard();
 
     const executor_ptr& get_executor() const noexcept;
 
     [[nodiscard]] strand_ptr make_strand();
 
+    // opt-in memory accounting (see memory_account.hpp)
+    // creates an account for the context executor. Strands made after this share it
+    // must be called before the context is run and before other threads post to it,
+    // as the executors read the account without synchronization
+    const memory_account_ptr& enable_memory_accounting();
+    // null if not enabled
+    const memory_account_ptr& get_memory_account() const noexcept;
+
     boost::asio::io_context& as_asio_io_context() noexcept;
 
-    void attach_object(std::string_view name, std::shared_ptr<void> obj);
+    // name of the asio reactor backend which xeq was built with: "io_uring", "epoll", "kqueue", "iocp"...
+    // the backend is selected at build time (see the XEQ_IO_URING cmake option)
+    static const char* backend_name() noexcept;
+
+    // objects attached to the context can be discovered by name
+    // every attached object is also given a dense slot which can be used for fast typed access through a key
+    // the slots of detached objects are reused, but every reuse bumps the generation of the slot,
+    // so a key to a detached object will safely return null
+    static constexpr uint32_t invalid_slot = ~uint32_t(0);
+
+    template <typename T>
+    struct key {
+        uint32_t slot = invalid_slot;
+        uint32_t generation = 0;
+        explicit operator bool() const noexcept { return slot != invalid_slot; }
+    };
+
+    void attach_object(std::string_view name, std::shared_ptr<void> obj) {
+        attach_object_slot(name, std::move(obj));
+    }
+    template <typename T>
+    key<T> attach_object(std::string_view name, std::shared_ptr<T> obj) {
+        auto k = attach_object_slot(name, std::move(obj));
+        return {k.slot, k.generation};
+    }
+
     [[nodiscard]] std::shared_ptr<void> get_object(std::string_view name) const noexcept;
     std::shared_ptr<void> detach_object(std::string_view name) noexcept;
 
+    // resolve a key from a name once, then use get(key) on the hot path
+    // it's up to the caller to provide the correct type (as with the shared_ptr<void> from get_object)
+    template <typename T>
+    [[nodiscard]] key<T> find_key(std::string_view name) const noexcept {
+        auto k = find_object_slot(name);
+        return {k.slot, k.generation};
+    }
+
+    // lock-free indexed load: no hashing, no locking
+    // returns null if the object has been detached
+    // the returned pointer is not a reference: it dangles if the object is detached concurrently and its last
+    // reference is released. Callers must hold their own reference to the object (say get_object once) or only
+    // detach it from the thread which uses the key
+    template <typename T>
+    [[nodiscard]] T* get(key<T> k) const noexcept {
+        return static_cast<T*>(get_object_slot({k.slot, k.generation}));
+    }
+
     struct impl;
 private:
     std::unique_ptr<impl> m_impl;
+
+    key<void> attach_object_slot(std::string_view name, std::shared_ptr<void> obj);
+    key<void> find_object_slot(std::string_view name) const noexcept;
+    void* get_object_slot(key<void> k) const noexcept;
 };
 } // namespace xeq
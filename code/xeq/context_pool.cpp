@@ -0,0 +1,287 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "context_pool.hpp"
+#include "context.hpp"
+#include "work_guard.hpp"
+#include "thread_name.hpp"
+#include "handler_allocator.hpp"
+#include "trace.hpp"
+#include "timer.hpp"
+#include "executor_bounds.hpp"
+#include "impl/accounted_handler.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/any_io_executor.hpp>
+
+#include <itlib/shared_from.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#   include <pthread.h>
+#   include <sched.h>
+#endif
+
+namespace asio = boost::asio;
+
+namespace xeq {
+
+namespace {
+
+class context_pool_impl;
+
+struct shard_thread_info {
+    const context_pool_impl* pool = nullptr;
+    size_t index = context_pool::no_shard;
+};
+thread_local shard_thread_info t_shard;
+
+void pin_this_thread(size_t i) {
+#if defined(__linux__)
+    const auto num_cpus = std::thread::hardware_concurrency();
+    if (num_cpus == 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(i % num_cpus, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)i; // not supported
+#endif
+}
+
+// a single-threaded context serializes everything posted to it, so this is a strand without an asio strand
+class shard_strand final : public strand, public itlib::enable_shared_from {
+public:
+    context& m_ctx;
+    asio::io_context::executor_type m_aexec;
+
+    explicit shard_strand(context& ctx)
+        : m_ctx(ctx)
+        , m_aexec(ctx.as_asio_io_context().get_executor())
+    {}
+
+    virtual void post(ufunc<void()> func) override {
+        if (trace::enabled()) [[unlikely]] {
+            func = trace::traced_post(this, std::move(func));
+        }
+        if (auto& b = get_bounds()) [[unlikely]] {
+            func = b->track(std::move(func));
+        }
+        if (auto& acct = get_memory_account()) [[unlikely]] {
+            return asio::post(m_aexec, impl::accounted_handler{std::move(func), acct});
+        }
+        asio::post(m_aexec, with_handler_allocator{std::move(func)});
+    }
+    virtual void post_resume(std::coroutine_handle<> handle) override {
+        if (trace::enabled() || get_bounds()) [[unlikely]] {
+            return post([=] { handle.resume(); });
+        }
+        if (auto& acct = get_memory_account()) [[unlikely]] {
+            return asio::post(m_aexec, impl::accounted_handler{[=]() { handle.resume(); }, acct});
+        }
+        asio::post(m_aexec, with_handler_allocator{[=]() {
+            handle.resume();
+        }});
+    }
+
+    virtual void post_call(void (*func)(void*), void* arg) override {
+        if (trace::enabled() || get_bounds()) [[unlikely]] {
+            return post([=] { func(arg); });
+        }
+        if (auto& acct = get_memory_account()) [[unlikely]] {
+            return asio::post(m_aexec, impl::accounted_handler{[=]() { func(arg); }, acct});
+        }
+        asio::post(m_aexec, with_handler_allocator{[=]() {
+            func(arg);
+        }});
+    }
+
+    executor_ptr get_super_executor() noexcept override {
+        return m_ctx.get_executor();
+    }
+
+    boost::asio::any_io_executor as_asio_executor() noexcept override {
+        return m_aexec;
+    }
+
+    strand_ptr make_strand() override {
+        return shared_from(this);
+    }
+
+    virtual bool running_in_this_thread() const noexcept override {
+        return m_aexec.running_in_this_thread();
+    }
+};
+
+// the executor may outlive the pool, so it holds it weakly
+// once the pool is destroyed, posts are dropped as they would be by a stopped context
+class pool_executor final : public executor, public itlib::enable_shared_from {
+public:
+    std::weak_ptr<context_pool> m_pool;
+
+    explicit pool_executor(std::weak_ptr<context_pool> pool)
+        : m_pool(std::move(pool))
+    {}
+
+    virtual void post(ufunc<void()> func) override {
+        if (auto pool = m_pool.lock()) {
+            pool->next_executor()->post(std::move(func));
+        }
+    }
+
+    virtual void post_resume(std::coroutine_handle<> handle) override {
+        if (auto pool = m_pool.lock()) {
+            pool->next_executor()->post_resume(handle);
+        }
+    }
+
+    virtual void post_call(void (*func)(void*), void* arg) override {
+        if (auto pool = m_pool.lock()) {
+            pool->next_executor()->post_call(func, arg);
+        }
+    }
+
+    virtual bool is_strand() const noexcept override { return false; }
+
+    virtual executor_ptr get_super_executor() noexcept override {
+        return shared_from(this);
+    }
+
+    boost::asio::any_io_executor as_asio_executor() noexcept override {
+        // asio objects are bound to a single shard, so it must always be the same one
+        auto pool = m_pool.lock();
+        if (!pool) return {};
+        return pool->shard_executor(0)->as_asio_executor();
+    }
+
+    // a timer is bound to one shard, so its waiters are resumed there rather than on any of them
+    virtual timer_ptr make_timer() override {
+        return timer::create(lock_pool()->next_executor());
+    }
+
+    strand_ptr make_strand() override {
+        return lock_pool()->make_strand();
+    }
+
+    virtual bool running_in_this_thread() const noexcept override {
+        auto pool = m_pool.lock();
+        return pool && pool->current_shard() != context_pool::no_shard;
+    }
+
+private:
+    context_pool_ptr lock_pool() const {
+        auto pool = m_pool.lock();
+        if (!pool) throw std::runtime_error("xeq::context_pool: the pool has been destroyed");
+        return pool;
+    }
+};
+
+class context_pool_impl final : public context_pool {
+public:
+    struct shard_data {
+        context ctx;
+        work_guard guard;
+        strand_ptr ex;
+
+        explicit shard_data(int concurrency_hint)
+            : ctx(concurrency_hint)
+            , guard(ctx.make_work_guard())
+        {
+            ex = std::make_shared<shard_strand>(ctx);
+        }
+    };
+
+    std::vector<std::unique_ptr<shard_data>> m_shards;
+    executor_ptr m_executor;
+    std::atomic_size_t m_next = 0;
+    std::vector<std::thread> m_threads;
+
+    explicit context_pool_impl(config&& cfg) {
+        auto n = cfg.num_shards;
+        if (n == 0) n = std::thread::hardware_concurrency();
+        if (n == 0) n = 1;
+
+        const int hint = cfg.unsafe_io ? BOOST_ASIO_CONCURRENCY_HINT_UNSAFE_IO : 1;
+
+        m_shards.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            m_shards.push_back(std::make_unique<shard_data>(hint));
+        }
+
+        m_threads.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            m_threads.push_back(std::thread([this, i, pin = cfg.pin_threads, name = cfg.name]() mutable {
+                if (!name.empty()) {
+                    name += ':';
+                    name += std::to_string(i);
+                    set_this_thread_name(name);
+                }
+                if (pin) {
+                    pin_this_thread(i);
+                }
+                t_shard = {this, i};
+                m_shards[i]->ctx.run();
+                t_shard = {};
+            }));
+        }
+    }
+
+    ~context_pool_impl() {
+        for (auto& s : m_shards) {
+            s->guard.reset();
+        }
+        stop();
+        for (auto& t : m_threads) {
+            t.join();
+        }
+    }
+
+    virtual size_t num_shards() const noexcept override {
+        return m_shards.size();
+    }
+
+    virtual context& shard(size_t i) noexcept override {
+        return m_shards[i]->ctx;
+    }
+
+    virtual const strand_ptr& shard_executor(size_t i) const noexcept override {
+        return m_shards[i]->ex;
+    }
+
+    virtual const strand_ptr& next_executor() noexcept override {
+        auto i = m_next.fetch_add(1, std::memory_order_relaxed);
+        return m_shards[i % m_shards.size()]->ex;
+    }
+
+    virtual size_t current_shard() const noexcept override {
+        if (t_shard.pool != this) return no_shard;
+        return t_shard.index;
+    }
+
+    virtual const executor_ptr& get_executor() const noexcept override {
+        return m_executor;
+    }
+
+    virtual void stop() noexcept override {
+        for (auto& s : m_shards) {
+            s->ctx.stop();
+        }
+    }
+};
+
+} // namespace
+
+context_pool::~context_pool() = default; // export vtable
+
+context_pool_ptr context_pool::create(config cfg) {
+    auto pool = std::make_shared<context_pool_impl>(std::move(cfg));
+    pool->m_executor = std::make_shared<pool_executor>(pool);
+    return pool;
+}
+
+} // namespace xeq
@@ -0,0 +1,106 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "api.h"
+#include "co_spawn.hpp"
+#include "coro.hpp"
+#include "executor.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace xeq {
+
+class context;
+
+// thread-per-core: N single-threaded contexts (shards), each run by its own thread
+//
+// the shards are created with a concurrency hint of 1, so asio can skip work it would do for multiple threads
+// (handlers posted from the shard's own thread don't touch the shared queue)
+// with unsafe_io, asio's reactor locking is also disabled: I/O objects (sockets, timers, files) created on a shard
+// must then only be used from that shard's thread. Posting to a shard from any thread is still safe
+//
+// every shard has a strand executor which posts directly to it: a single-threaded shard already serializes
+// its handlers, so no asio strand is needed
+//
+// the pool executor spreads posts round-robin across shards. Note that a coroutine which is spawned directly
+// on it would migrate between shards on every resume. Use co_spawn(pool, ...) to pin a coroutine to a shard
+// for the same reason a timer created with the pool executor runs on one shard (picked round-robin),
+// and the asio executor of the pool executor (which I/O objects are bound to) is always that of shard 0
+// the pool executor may outlive the pool, but what is posted to it after that is dropped
+
+class context_pool;
+using context_pool_ptr = std::shared_ptr<context_pool>;
+
+class XEQ_API context_pool {
+public:
+    static constexpr size_t no_shard = ~size_t(0);
+
+    struct config {
+        size_t num_shards = 0; // 0 means std::thread::hardware_concurrency()
+        bool pin_threads = true; // pin shard i to cpu i % num_cpus (where supported)
+        bool unsafe_io = false; // see above
+        std::string name = "xeq-shard"; // threads are named name:i
+    };
+
+    virtual ~context_pool();
+
+    context_pool(const context_pool&) = delete;
+    context_pool& operator=(const context_pool&) = delete;
+
+    // the threads start immediately and run until the pool is destroyed
+    static context_pool_ptr create(config cfg);
+    static context_pool_ptr create() { return create(config{}); }
+
+    virtual size_t num_shards() const noexcept = 0;
+
+    virtual context& shard(size_t i) noexcept = 0;
+
+    virtual const strand_ptr& shard_executor(size_t i) const noexcept = 0;
+
+    // round-robin
+    virtual const strand_ptr& next_executor() noexcept = 0;
+
+    // the same key always maps to the same shard
+    const strand_ptr& executor_for(uint64_t key) const noexcept {
+        // fibonacci hashing so that sequential keys don't depend on the modulo alone
+        const auto h = (key * 0x9E3779B97F4A7C15ull) >> 32;
+        return shard_executor(size_t(h % num_shards()));
+    }
+
+    // the shard executor of the calling thread or no_shard if it's not one of the pool's threads
+    virtual size_t current_shard() const noexcept = 0;
+
+    // executor which spreads posts across shards
+    virtual const executor_ptr& get_executor() const noexcept = 0;
+
+    // a shard executor is already a strand
+    [[nodiscard]] strand_ptr make_strand() {
+        return next_executor();
+    }
+
+    void post(ufunc<void()> func) {
+        next_executor()->post(std::move(func));
+    }
+
+    void post(uint64_t key, ufunc<void()> func) {
+        executor_for(key)->post(std::move(func));
+    }
+
+    // stop all shards without waiting for pending work
+    virtual void stop() noexcept = 0;
+
+protected:
+    context_pool() = default;
+};
+
+inline void co_spawn(context_pool& pool, coro<void> c) {
+    co_spawn(pool.next_executor(), std::move(c));
+}
+
+inline void co_spawn(context_pool& pool, uint64_t key, coro<void> c) {
+    co_spawn(pool.executor_for(key), std::move(c));
+}
+
+} // namespace xeq
@@ -2,11 +2,14 @@
 // SPDX-License-Identifier: MIT
 //
 #pragma once
+#include "api.h"
 #include "executor_ptr.hpp"
 #include <itlib/expected.hpp>
 #include <coroutine>
+#include <chrono>
 #include <stdexcept>
 #include <cassert>
+#include <cstddef>
 #include <optional>
 
 namespace xeq {
@@ -14,8 +17,24 @@ namespace xeq {
 template <typename T>
 using coro_result = itlib::expected<T, std::exception_ptr>;
 
+template <typename T>
+class executor_local;
+
+// absolute deadline of a coroutine task, inherited by nested coroutines
+// only used for scheduling by deadline-aware executors (see deadline_scheduler.hpp)
+using coro_deadline = std::chrono::steady_clock::time_point;
+inline constexpr coro_deadline no_deadline = coro_deadline::max();
+
 namespace impl {
 
+#if XEQ_FRAME_ACCOUNTING
+// coroutine frames are charged to the memory account of the executor whose handler allocates them
+// (see memory_account.hpp)
+// only with the XEQ_FRAME_ACCOUNTING cmake option (off by default), otherwise frames use the default allocation
+XEQ_API void* coro_frame_allocate(size_t size);
+XEQ_API void coro_frame_deallocate(void* frame, size_t size) noexcept;
+#endif
+
 template <typename T, typename Self>
 struct ret_promise_helper {
     void return_value(T value) noexcept {
@@ -62,6 +81,15 @@ struct [[nodiscard]] coro {
     using gen_result_type = itlib::eoptional<Gen>;
 
     struct promise_type : impl::ret_promise_helper<Ret, promise_type> {
+#if XEQ_FRAME_ACCOUNTING
+        static void* operator new(size_t size) {
+            return impl::coro_frame_allocate(size);
+        }
+        static void operator delete(void* frame, size_t size) noexcept {
+            impl::coro_frame_deallocate(frame, size);
+        }
+#endif
+
         coro get_return_object() noexcept {
             return coro{handle_type::from_promise(*this)};
         }
@@ -99,6 +127,7 @@ struct [[nodiscard]] coro {
         }
 
         executor_ptr m_executor;
+        coro_deadline m_deadline = no_deadline;
         std::coroutine_handle<> m_prev = nullptr;
 
         // the following point to the result in the awaitable which is on the stack
@@ -141,6 +170,7 @@ struct [[nodiscard]] coro {
         std::coroutine_handle<> await_suspend(std::coroutine_handle<CallerPromise> caller) noexcept {
             hcoro.promise().m_result = &result;
             hcoro.promise().m_executor = caller.promise().m_executor;
+            hcoro.promise().m_deadline = caller.promise().m_deadline;
             hcoro.promise().m_prev = caller;
             return hcoro;
         }
@@ -188,6 +218,7 @@ struct [[nodiscard]] coro {
             hcoro.promise().m_result = &result;
             hcoro.promise().m_generated = &gen;
             hcoro.promise().m_executor = caller.promise().m_executor;
+            hcoro.promise().m_deadline = caller.promise().m_deadline;
             hcoro.promise().m_prev = caller;
             return hcoro;
         }
@@ -242,6 +273,40 @@ struct this_coro {
 
         const executor_ptr& await_resume() noexcept { return *m_executor; }
     };
+
+    struct deadline {
+        coro_deadline m_deadline;
+
+        // awaitable interface
+        bool await_ready() const noexcept { return false; }
+        template <typename PromiseType>
+        bool await_suspend(std::coroutine_handle<PromiseType> h) noexcept {
+            m_deadline = h.promise().m_deadline;
+            return false;
+        }
+
+        coro_deadline await_resume() noexcept { return m_deadline; }
+    };
+
+    // the value of an executor_local key for the coroutine's executor (see executor_local.hpp)
+    // auto& buf = co_await this_coro::local{key};
+    template <typename T>
+    struct local {
+        const executor_local<T>& m_key;
+        executor_ptr* m_executor = nullptr;
+
+        // awaitable interface
+        bool await_ready() const noexcept { return false; }
+        template <typename PromiseType>
+        bool await_suspend(std::coroutine_handle<PromiseType> h) noexcept {
+            m_executor = &h.promise().m_executor;
+            return false;
+        }
+
+        T& await_resume() { return m_key.get(**m_executor); }
+    };
+    template <typename T>
+    local(const executor_local<T>&) -> local<T>;
 };
 
 template <typename Gen, typename Ret = void>
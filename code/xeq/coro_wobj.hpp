@@ -3,15 +3,29 @@
 //
 #pragma once
 #include "timeout.hpp"
+#include "wait_node.hpp"
 #include <coroutine>
 #include <system_error>
 
 namespace xeq {
 
-struct basic_wait_awaitable {
+// the awaitables live in the coroutine frame, so they are the wait nodes themselves
+// with wait objects which support wait_node, awaiting them does no allocation
+
+struct basic_wait_awaitable : public wait_node {
     bool ret = false;
+    std::coroutine_handle<> handle;
+
+    basic_wait_awaitable() : wait_node{on_complete} {}
+
     bool await_ready() const noexcept { return false; }
     bool await_resume() noexcept { return ret; }
+
+    static void on_complete(wait_node& self, const error_code& ec) {
+        auto& a = static_cast<basic_wait_awaitable&>(self);
+        a.ret = !!ec;
+        a.handle.resume();
+    }
 };
 
 template <typename Wobj>
@@ -19,10 +33,15 @@ struct wait_awaitable : basic_wait_awaitable {
     Wobj& wobj;
     wait_awaitable(Wobj& w) : wobj(w) {}
     void await_suspend(std::coroutine_handle<> h) {
-        wobj.wait([this, h](const std::error_code& ec) {
-            ret = !!ec;
-            h.resume();
-        });
+        handle = h;
+        if constexpr (requires { wobj.wait(static_cast<wait_node&>(*this)); }) {
+            wobj.wait(static_cast<wait_node&>(*this));
+        }
+        else {
+            wobj.wait([this](const std::error_code& ec) {
+                on_complete(*this, ec);
+            });
+        }
     }
 };
 
@@ -32,10 +51,15 @@ struct timeout_awaitable : basic_wait_awaitable {
     timeout to;
     timeout_awaitable(Wobj& w, timeout t) : wobj(w), to(t) {}
     void await_suspend(std::coroutine_handle<> h) {
-        wobj.wait(to, [this, h](const std::error_code& ec) {
-            ret = !!ec;
-            h.resume();
-        });
+        handle = h;
+        if constexpr (requires { wobj.wait(to, static_cast<wait_node&>(*this)); }) {
+            wobj.wait(to, static_cast<wait_node&>(*this));
+        }
+        else {
+            wobj.wait(to, [this](const std::error_code& ec) {
+                on_complete(*this, ec);
+            });
+        }
     }
 };
 
@@ -0,0 +1,153 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "deadline_scheduler.hpp"
+#include "context.hpp"
+#include "impl/queued_executor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace asio = boost::asio;
+
+namespace xeq {
+
+namespace {
+
+class deadline_queue : public itlib::enable_shared_from {
+public:
+    using key_type = coro_deadline;
+
+    asio::io_context::executor_type m_aexec;
+
+    deadline_queue(asio::io_context::executor_type aexec, deadline_scheduler::config&& cfg)
+        : m_aexec(std::move(aexec))
+        , m_config(std::move(cfg))
+    {}
+
+    ~deadline_queue() {
+        // tasks which never started are ours to destroy
+        for (auto& e : m_heap) {
+            if (e.start) e.start.destroy();
+        }
+    }
+
+    void push(coro_deadline d, ufunc<void()> func) {
+        push_entry({d, 0, std::move(func), nullptr});
+    }
+
+    void push_start(coro_deadline d, std::coroutine_handle<> h) {
+        push_entry({d, 0, nullptr, h});
+    }
+
+    deadline_scheduler::stats get_stats() {
+        deadline_scheduler::stats ret;
+        ret.executed = m_executed.load(std::memory_order_relaxed);
+        ret.started_late = m_started_late.load(std::memory_order_relaxed);
+        ret.shed = m_shed.load(std::memory_order_relaxed);
+        std::lock_guard l(m_mutex);
+        ret.queued = m_heap.size();
+        return ret;
+    }
+
+private:
+    struct entry {
+        coro_deadline deadline;
+        uint64_t seq; // FIFO for equal deadlines
+        ufunc<void()> func;
+        std::coroutine_handle<> start; // if not null, this is a task start and func is empty
+    };
+
+    // min-heap by deadline
+    static bool later(const entry& a, const entry& b) noexcept {
+        if (a.deadline != b.deadline) return a.deadline > b.deadline;
+        return a.seq > b.seq;
+    }
+
+    deadline_scheduler::config m_config;
+
+    std::mutex m_mutex;
+    std::vector<entry> m_heap;
+    uint64_t m_next_seq = 0;
+
+    std::atomic_uint64_t m_executed = 0;
+    std::atomic_uint64_t m_started_late = 0;
+    std::atomic_uint64_t m_shed = 0;
+
+    void push_entry(entry e) {
+        {
+            std::lock_guard l(m_mutex);
+            e.seq = m_next_seq++;
+            m_heap.push_back(std::move(e));
+            std::push_heap(m_heap.begin(), m_heap.end(), later);
+        }
+        // one token per entry, so that every token has something to execute
+        asio::post(m_aexec, with_handler_allocator{[self = shared_from(this)] {
+            self->run_one();
+        }});
+    }
+
+    void run_one() {
+        entry e;
+        {
+            std::lock_guard l(m_mutex);
+            if (m_heap.empty()) return; // rescue: tokens match entries one to one
+            std::pop_heap(m_heap.begin(), m_heap.end(), later);
+            e = std::move(m_heap.back());
+            m_heap.pop_back();
+        }
+
+        if (!e.start) {
+            m_executed.fetch_add(1, std::memory_order_relaxed);
+            e.func();
+            return;
+        }
+
+        const bool expired = e.deadline != no_deadline && e.deadline < coro_deadline::clock::now();
+        if (expired && m_config.shed_expired) {
+            m_shed.fetch_add(1, std::memory_order_relaxed);
+            e.start.destroy();
+            if (m_config.on_shed) m_config.on_shed(e.deadline);
+            return;
+        }
+
+        if (expired) {
+            m_started_late.fetch_add(1, std::memory_order_relaxed);
+        }
+        m_executed.fetch_add(1, std::memory_order_relaxed);
+        e.start.resume();
+    }
+};
+
+class deadline_scheduler_impl final : public deadline_scheduler {
+public:
+    std::shared_ptr<deadline_queue> m_queue;
+
+    deadline_scheduler_impl(context& ctx, config&& cfg)
+        : m_queue(std::make_shared<deadline_queue>(ctx.as_asio_io_context().get_executor(), std::move(cfg)))
+    {}
+
+    virtual executor_ptr get_executor(coro_deadline d) override {
+        return std::make_shared<impl::queued_executor<deadline_queue>>(m_queue, d);
+    }
+
+    virtual void post_start(coro_deadline d, std::coroutine_handle<> h) override {
+        m_queue->push_start(d, h);
+    }
+
+    virtual stats get_stats() const override {
+        return m_queue->get_stats();
+    }
+};
+
+} // namespace
+
+deadline_scheduler::~deadline_scheduler() = default; // export vtable
+
+deadline_scheduler_ptr deadline_scheduler::create(context& ctx, config cfg) {
+    return std::make_shared<deadline_scheduler_impl>(ctx, std::move(cfg));
+}
+
+} // namespace xeq
@@ -0,0 +1,86 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "api.h"
+#include "coro.hpp"
+#include "executor.hpp"
+#include "ufunc.hpp"
+#include <cstdint>
+#include <memory>
+
+namespace xeq {
+
+class context;
+
+// earliest deadline first scheduling on top of a context
+//
+// every post goes to a queue ordered by deadline (FIFO for equal deadlines)
+// and a generic token is posted to the context: whichever thread picks a token runs the earliest entry
+//
+// co_spawn with a deadline sets it in the promise (nested coroutines inherit it, see this_coro::deadline)
+// and uses an executor which schedules with this deadline, so everything which resumes through the task's
+// executor is ordered by it
+//
+// when shedding is enabled, tasks which are past their deadline when they are about to start are destroyed
+// without running. Tasks which have already started are never shed: they must be allowed to unwind
+
+class deadline_scheduler;
+using deadline_scheduler_ptr = std::shared_ptr<deadline_scheduler>;
+
+class XEQ_API deadline_scheduler {
+public:
+    struct config {
+        bool shed_expired = false;
+
+        // called with the deadline of a shed task, from the thread which would have started it
+        ufunc<void(coro_deadline)> on_shed;
+    };
+
+    struct stats {
+        uint64_t executed; // handlers and task resumes
+        uint64_t started_late; // tasks which were started after their deadline
+        uint64_t shed; // tasks which were destroyed without starting
+        size_t queued;
+    };
+
+    virtual ~deadline_scheduler();
+
+    deadline_scheduler(const deadline_scheduler&) = delete;
+    deadline_scheduler& operator=(const deadline_scheduler&) = delete;
+
+    static deadline_scheduler_ptr create(context& ctx, config cfg);
+    static deadline_scheduler_ptr create(context& ctx) { return create(ctx, config{}); }
+
+    // executor which schedules everything with the given deadline
+    // every call allocates a new executor (deadlines are rarely reused), so keep it for as long as the deadline
+    // applies instead of calling this for every post (co_spawn makes one for the entire task)
+    // as they are new objects, executors for the same deadline compare unequal. Code which compares executors
+    // (say to skip a hop to the executor it's already on) sees them as different ones, though they all post
+    // to the same queue
+    [[nodiscard]] virtual executor_ptr get_executor(coro_deadline d) = 0;
+
+    // a one-off post: allocates an executor as above
+    void post(coro_deadline d, ufunc<void()> func) {
+        get_executor(d)->post(std::move(func));
+    }
+
+    // schedule the start of a task
+    // the handle is destroyed instead of resumed if it gets shed
+    virtual void post_start(coro_deadline d, std::coroutine_handle<> h) = 0;
+
+    virtual stats get_stats() const = 0;
+
+protected:
+    deadline_scheduler() = default;
+};
+
+// allocates the task's executor (see get_executor)
+inline void co_spawn(const deadline_scheduler_ptr& s, coro_deadline d, coro<void> c) {
+    auto h = c.take_handle();
+    h.promise().m_executor = s->get_executor(d);
+    h.promise().m_deadline = d;
+    s->post_start(d, h);
+}
+
+} // namespace xeq
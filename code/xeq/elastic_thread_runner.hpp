@@ -0,0 +1,316 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "context.hpp"
+#include "executor.hpp"
+#include "thread_name.hpp"
+#include "ufunc.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <cassert>
+
+// run a context in a varying number of threads depending on load
+//
+// the load is measured by a monitor thread which periodically posts a probe to the context
+// and measures how long it waits in the queue, thus nothing is added to the path of other handlers
+// * when the probe latency stays above spawn_latency for spawn_after probes in a row, a worker is added
+// * when the probe latency stays below idle_latency for idle_period, a worker is retired
+//
+// a worker is retired by posting a handler which throws a private exception type:
+// asio propagates it out of the run() of the thread which executed the handler and no other
+// if the handler is executed by a thread which is not one of the workers (say a user thread in ctx.run()),
+// it's dropped and the monitor decides again after another idle period
+
+namespace xeq {
+class elastic_thread_runner {
+public:
+    using clock_type = std::chrono::steady_clock;
+    using duration = clock_type::duration;
+
+    struct config {
+        size_t min_threads = 1;
+        size_t max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+        duration probe_interval = std::chrono::milliseconds(10);
+
+        duration spawn_latency = std::chrono::milliseconds(1);
+        size_t spawn_after = 3; // consecutive probes above spawn_latency
+
+        duration idle_latency = std::chrono::microseconds(100);
+        duration idle_period = std::chrono::seconds(10);
+
+        std::string name;
+
+        // called with the number of threads after the change
+        // on_spawn is called from the monitor thread when a worker is added
+        // on_retire is called from the retiring worker just before it exits (so the two can be called concurrently)
+        ufunc<void(size_t num_threads)> on_spawn;
+        ufunc<void(size_t num_threads)> on_retire;
+    };
+
+    struct stats {
+        size_t num_threads;
+        uint64_t spawned;
+        uint64_t retired;
+        uint64_t probes;
+        duration last_probe_latency;
+        duration max_probe_latency;
+    };
+
+    elastic_thread_runner() = default;
+    elastic_thread_runner(context& ctx, config cfg) {
+        start(ctx, std::move(cfg));
+    }
+
+    ~elastic_thread_runner() {
+        join();
+    }
+
+    elastic_thread_runner(const elastic_thread_runner&) = delete;
+    elastic_thread_runner& operator=(const elastic_thread_runner&) = delete;
+
+    void start(context& ctx, config cfg) {
+        assert(!m_monitor.joinable());
+        if (m_monitor.joinable()) return; // rescue
+        assert(cfg.min_threads <= cfg.max_threads);
+
+        m_ctx = &ctx;
+        m_config = std::move(cfg);
+        m_stop = false;
+        m_shared = std::make_shared<shared_state>(); // retire handlers from a previous start may still be queued
+
+        {
+            std::lock_guard l(m_workers_mutex);
+            for (size_t i = 0; i < m_config.min_threads; ++i) {
+                spawn_worker();
+            }
+        }
+
+        m_monitor = std::thread([this] { monitor(); });
+    }
+
+    // as with thread_runner, this waits for the context to run out of work or be stopped
+    void join() {
+        if (!m_monitor.joinable()) return;
+        {
+            std::lock_guard l(m_shared->mutex);
+            m_stop = true;
+        }
+        m_shared->cv.notify_one();
+        m_monitor.join();
+
+        std::lock_guard l(m_workers_mutex);
+        for (auto& w : m_workers) {
+            w.thread.join();
+        }
+        m_workers.clear();
+        m_num_threads = 0;
+    }
+
+    size_t num_threads() const noexcept {
+        return m_num_threads.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const noexcept {
+        return num_threads() == 0;
+    }
+
+    stats get_stats() const noexcept {
+        return {
+            num_threads(),
+            m_spawned.load(std::memory_order_relaxed),
+            m_retired.load(std::memory_order_relaxed),
+            m_probes.load(std::memory_order_relaxed),
+            duration(m_last_probe_latency.load(std::memory_order_relaxed)),
+            duration(m_max_probe_latency.load(std::memory_order_relaxed)),
+        };
+    }
+
+private:
+    struct retire_signal {};
+
+    struct worker {
+        std::thread thread;
+        std::atomic_bool done = false;
+    };
+
+    // shared with the posted probes and retire handlers so that they can outlive the runner
+    struct shared_state {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool done = true;
+        clock_type::time_point ran_at;
+
+        // retire handlers which haven't been executed yet
+        std::atomic_size_t pending_retires = 0;
+    };
+
+    context* m_ctx = nullptr;
+    config m_config;
+
+    std::mutex m_workers_mutex;
+    std::list<worker> m_workers; // list so that the workers don't move
+    size_t m_next_index = 0;
+
+    // used to make sure only our workers retire, should a retire handler outlive the runner or its start
+    // (the handlers hold the state, so its address is not reused while they are alive)
+    inline static thread_local const void* t_current_state = nullptr;
+
+    std::thread m_monitor;
+    std::shared_ptr<shared_state> m_shared = std::make_shared<shared_state>();
+    bool m_stop = false; // protected by m_shared->mutex
+
+    std::atomic_size_t m_num_threads = 0;
+    std::atomic_uint64_t m_spawned = 0;
+    std::atomic_uint64_t m_retired = 0;
+    std::atomic_uint64_t m_probes = 0;
+    std::atomic<duration::rep> m_last_probe_latency = 0;
+    std::atomic<duration::rep> m_max_probe_latency = 0;
+
+    // call with m_workers_mutex locked
+    void spawn_worker() {
+        auto& w = m_workers.emplace_back();
+        auto i = m_next_index++;
+        ++m_num_threads;
+        w.thread = std::thread([this, &w, i, name = m_config.name, shared = m_shared]() mutable {
+            if (!name.empty()) {
+                name += ':';
+                name += std::to_string(i);
+                set_this_thread_name(name);
+            }
+            t_current_state = shared.get();
+            try {
+                m_ctx->run();
+            }
+            catch (const retire_signal&) {
+                --shared->pending_retires;
+                ++m_retired;
+                if (m_config.on_retire) m_config.on_retire(m_num_threads.load(std::memory_order_relaxed) - 1);
+            }
+            --m_num_threads;
+            w.done.store(true, std::memory_order_release);
+        });
+    }
+
+    void reap_workers() {
+        std::lock_guard l(m_workers_mutex);
+        for (auto it = m_workers.begin(); it != m_workers.end(); ) {
+            if (it->done.load(std::memory_order_acquire)) {
+                it->thread.join();
+                it = m_workers.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    void record_latency(duration latency) {
+        ++m_probes;
+        m_last_probe_latency.store(latency.count(), std::memory_order_relaxed);
+        if (latency.count() > m_max_probe_latency.load(std::memory_order_relaxed)) {
+            m_max_probe_latency.store(latency.count(), std::memory_order_relaxed);
+        }
+    }
+
+    void monitor() {
+        auto& probe = *m_shared;
+        size_t high_streak = 0;
+        clock_type::time_point idle_since = {};
+
+        std::unique_lock lock(probe.mutex);
+        while (!m_stop) {
+            // only one probe in flight, so as not to add load to a saturated context
+            probe.done = false;
+            const auto posted_at = clock_type::now();
+            m_ctx->get_executor()->post([p = m_shared] {
+                {
+                    std::lock_guard l(p->mutex);
+                    p->done = true;
+                    p->ran_at = clock_type::now();
+                }
+                p->cv.notify_one();
+            });
+
+            auto deadline = posted_at + m_config.probe_interval;
+            while (true) {
+                probe.cv.wait_until(lock, deadline, [&] { return probe.done || m_stop; });
+                if (m_stop) return;
+
+                // a probe which hasn't run yet has been waiting at least this long
+                const bool ran = probe.done;
+                const auto latency = (ran ? probe.ran_at : clock_type::now()) - posted_at;
+
+                lock.unlock();
+                reap_workers();
+                if (ran) {
+                    record_latency(latency);
+                }
+                decide(latency, high_streak, idle_since);
+                lock.lock();
+
+                if (ran) break;
+                deadline += m_config.probe_interval;
+            }
+
+            // keep a steady probe rate
+            probe.cv.wait_until(lock, deadline, [&] { return m_stop; });
+        }
+    }
+
+    void decide(duration latency, size_t& high_streak, clock_type::time_point& idle_since) {
+        const auto now = clock_type::now();
+        const auto pending = m_shared->pending_retires.load(std::memory_order_relaxed);
+        const auto total = m_num_threads.load(std::memory_order_relaxed);
+        const auto live = total > pending ? total - pending : 0;
+
+        if (latency >= m_config.spawn_latency) {
+            idle_since = {};
+            if (++high_streak < m_config.spawn_after) return;
+            high_streak = 0;
+            if (live >= m_config.max_threads) return;
+            if (m_ctx->stopped()) return; // nothing to do, don't spawn threads which will exit immediately
+            {
+                std::lock_guard l(m_workers_mutex);
+                spawn_worker();
+            }
+            ++m_spawned;
+            if (m_config.on_spawn) m_config.on_spawn(live + 1);
+            return;
+        }
+
+        high_streak = 0;
+
+        if (latency > m_config.idle_latency) {
+            idle_since = {};
+            return;
+        }
+
+        if (idle_since == clock_type::time_point{}) {
+            idle_since = now;
+            return;
+        }
+
+        if (now - idle_since < m_config.idle_period) return;
+        idle_since = now; // restart the idle period for the next retirement
+        if (live <= m_config.min_threads) return;
+
+        ++m_shared->pending_retires;
+        m_ctx->get_executor()->post([p = m_shared] {
+            if (t_current_state == p.get()) {
+                throw retire_signal{}; // the worker accounts for it as it exits
+            }
+            // not one of our workers, so nothing retires
+            --p->pending_retires;
+        });
+    }
+};
+
+} // namespace xeq
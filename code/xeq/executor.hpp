@@ -6,6 +6,7 @@
 #include "ufunc.hpp"
 #include "work_guard.hpp"
 #include "executor_ptr.hpp"
+#include "executor_local_storage.hpp"
 #include <coroutine>
 #include <memory>
 
@@ -15,6 +16,15 @@ class any_io_executor;
 
 namespace xeq {
 
+class memory_account;
+using memory_account_ptr = std::shared_ptr<memory_account>;
+
+class executor_bounds;
+using executor_bounds_ptr = std::shared_ptr<executor_bounds>;
+
+class timer;
+using timer_ptr = std::unique_ptr<timer>;
+
 class XEQ_API executor {
 public:
     work_guard make_work_guard();
@@ -22,6 +32,10 @@ public:
     virtual void post(ufunc<void()> func) = 0;
     virtual void post_resume(std::coroutine_handle<> handle) = 0;
 
+    // post a plain function and its argument (which must outlive the call)
+    // unlike post, this doesn't allocate a type-erased callable
+    virtual void post_call(void (*func)(void*), void* arg);
+
     virtual bool is_strand() const noexcept = 0;
 
     virtual executor_ptr get_super_executor() noexcept = 0;
@@ -32,10 +46,38 @@ public:
 
     virtual boost::asio::any_io_executor as_asio_executor() noexcept = 0;
 
+    // storage for executor_local values (see executor_local.hpp)
+    executor_local_storage& local_storage() noexcept { return m_local_storage; }
+
+    // memory accounting (see memory_account.hpp), null if disabled
+    // set it before the executor is in use
+    const memory_account_ptr& get_memory_account() const noexcept { return m_memory_account; }
+    void set_memory_account(memory_account_ptr acct) noexcept { m_memory_account = std::move(acct); }
+
+    // bounded mode (see executor_bounds.hpp), null if unbounded
+    // set it before the executor is in use
+    const executor_bounds_ptr& get_bounds() const noexcept { return m_bounds; }
+    void set_bounds(executor_bounds_ptr bounds) noexcept { m_bounds = std::move(bounds); }
+
+    // post unless the executor is bounded and its queue is full
+    // returns false (and drops func) if it didn't post
+    bool try_post(ufunc<void()> func);
+
 protected:
     // protected as it's only managed by shared_ptr
     // virtual so as to export the vtable
     virtual ~executor();
+
+    // used by timer::create
+    // executors which don't run on an asio context (see sim_context.hpp) provide their own timers
+    // null means the default asio timer
+    virtual timer_ptr make_timer();
+    friend class timer;
+
+private:
+    executor_local_storage m_local_storage;
+    memory_account_ptr m_memory_account;
+    executor_bounds_ptr m_bounds;
 };
 
 class XEQ_API strand : public executor {
@@ -47,4 +89,17 @@ protected:
     virtual ~strand();
 };
 
+namespace impl {
+// generic code (like the wait objects) can take either an executor_ptr or a typed executor (see typed_executor.hpp)
+template <typename Executor>
+Executor& executor_of(const std::shared_ptr<Executor>& ex) noexcept { return *ex; }
+template <typename TypedExecutor>
+const TypedExecutor& executor_of(const TypedExecutor& ex) noexcept { return ex; }
+
+template <typename Executor>
+const std::shared_ptr<Executor>& erased_executor(const std::shared_ptr<Executor>& ex) noexcept { return ex; }
+template <typename TypedExecutor>
+decltype(auto) erased_executor(const TypedExecutor& ex) noexcept { return ex.get_executor(); }
+} // namespace impl
+
 } // namespace xeq
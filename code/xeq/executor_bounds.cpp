@@ -0,0 +1,98 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "executor_bounds.hpp"
+
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace xeq {
+
+bool executor::try_post(ufunc<void()> func) {
+    if (m_bounds && !m_bounds->has_room()) return false;
+    post(std::move(func));
+    return true;
+}
+
+// leaves the queue when released or destroyed (a handler which never runs because its context is destroyed)
+class executor_bounds::depth_token {
+public:
+    explicit depth_token(std::shared_ptr<executor_bounds> b) noexcept : m_bounds(std::move(b)) {}
+    depth_token(depth_token&&) noexcept = default;
+    depth_token& operator=(depth_token&&) = delete;
+    ~depth_token() { release(); }
+
+    void release() noexcept {
+        if (auto b = std::move(m_bounds)) {
+            b->leave();
+        }
+    }
+private:
+    std::shared_ptr<executor_bounds> m_bounds;
+};
+
+executor_bounds_ptr executor_bounds::create(config cfg) {
+    return std::make_shared<executor_bounds>(std::move(cfg));
+}
+
+executor_bounds::executor_bounds(config&& cfg)
+    : m_config(std::move(cfg))
+{
+    // the callbacks are called from noexcept paths, so everything is checked here
+    if (m_config.capacity == 0) throw std::runtime_error("xeq::executor_bounds: capacity must be positive");
+    if (m_config.high_watermark) {
+        if (!m_config.on_high || !m_config.on_low) throw std::runtime_error("xeq::executor_bounds: watermarks need both callbacks");
+        if (m_config.low_watermark >= m_config.high_watermark) throw std::runtime_error("xeq::executor_bounds: low watermark must be below the high one");
+    }
+}
+
+executor_bounds::~executor_bounds() = default;
+
+ufunc<void()> executor_bounds::track(ufunc<void()> func) {
+    enter();
+    return [token = depth_token(shared_from(this)), func = std::move(func)]() mutable {
+        token.release();
+        func();
+    };
+}
+
+void executor_bounds::enter() noexcept {
+    const auto d = m_depth.fetch_add(1) + 1;
+    if (m_config.high_watermark && d >= m_config.high_watermark && !m_high.exchange(true)) {
+        m_config.on_high(d);
+    }
+}
+
+void executor_bounds::leave() noexcept {
+    const auto d = m_depth.fetch_sub(1) - 1;
+    if (d <= m_config.low_watermark && m_high.load(std::memory_order_relaxed) && m_high.exchange(false)) {
+        m_config.on_low(d);
+    }
+
+    if (d >= m_config.capacity || !m_num_waiters.load()) return;
+
+    std::optional<waiter> w;
+    {
+        std::lock_guard l(m_waiters_mutex);
+        if (m_waiters.empty()) return;
+        w.emplace(std::move(m_waiters.front()));
+        m_waiters.pop_front();
+        --m_num_waiters;
+    }
+    w->ex->post_resume(w->handle);
+}
+
+bool executor_bounds::wait_for_room(std::coroutine_handle<> h, const executor_ptr& ex) {
+    std::lock_guard l(m_waiters_mutex);
+    // register before checking, so that a concurrent leave either sees us or leaves room for us to see
+    ++m_num_waiters;
+    if (m_depth.load() < m_config.capacity) {
+        --m_num_waiters;
+        return false;
+    }
+    m_waiters.push_back({h, ex});
+    return true;
+}
+
+} // namespace xeq
@@ -0,0 +1,121 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "api.h"
+#include "executor.hpp"
+#include "ufunc.hpp"
+#include <itlib/shared_from.hpp>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace xeq {
+
+// bounded mode for executors: admission control for their queues
+//
+// ex->set_bounds(executor_bounds::create({.capacity = 10'000, .high_watermark = 8000, .low_watermark = 2000,
+//     .on_high = [](size_t) { pause_accepting(); }, .on_low = [](size_t) { resume_accepting(); }}));
+//
+// the depth of a bounded executor is the number of handlers (posts and coroutine resumes) which were posted to it
+// and haven't started running yet
+// * ex->try_post(f) doesn't post and returns false when the depth has reached the capacity
+// * co_await post_or_wait(ex, f) suspends the calling coroutine until there is room
+// * post still always posts. Use it for work which must not be dropped
+// the capacity is soft: concurrent producers may overshoot it by one each
+//
+// the watermark callbacks are edge triggered: on_high when the depth reaches the high watermark
+// and then on_low when it drops to the low one. They are called on the thread which changes the depth
+// and must not throw: they are called from noexcept code (a throw terminates)
+// one bounds object can be shared by several executors, which are then bounded together
+
+class executor_bounds;
+using executor_bounds_ptr = std::shared_ptr<executor_bounds>;
+
+class XEQ_API executor_bounds : public itlib::enable_shared_from {
+public:
+    struct config {
+        size_t capacity = 1024;
+        size_t high_watermark = 0; // 0 means no watermark callbacks, otherwise both are required
+        size_t low_watermark = 0;
+        ufunc<void(size_t depth)> on_high;
+        ufunc<void(size_t depth)> on_low;
+    };
+
+    // throws if the capacity is 0, or if a high watermark is set without both callbacks or not above the low one
+    static executor_bounds_ptr create(config cfg);
+
+    explicit executor_bounds(config&& cfg);
+    ~executor_bounds();
+
+    executor_bounds(const executor_bounds&) = delete;
+    executor_bounds& operator=(const executor_bounds&) = delete;
+
+    size_t capacity() const noexcept { return m_config.capacity; }
+    size_t depth() const noexcept { return m_depth.load(std::memory_order_relaxed); }
+    bool has_room() const noexcept { return depth() < m_config.capacity; }
+
+    // used by the executors: count the handler in the depth until it starts running or is destroyed
+    [[nodiscard]] ufunc<void()> track(ufunc<void()> func);
+
+    // the coroutine is resumed on its executor when there is room
+    // returns false if there is room already
+    bool wait_for_room(std::coroutine_handle<> h, const executor_ptr& ex);
+
+private:
+    void enter() noexcept;
+    void leave() noexcept;
+
+    class depth_token;
+
+    config m_config;
+    std::atomic_size_t m_depth = 0;
+    std::atomic_bool m_high = false;
+
+    struct waiter {
+        std::coroutine_handle<> handle;
+        executor_ptr ex;
+    };
+    std::mutex m_waiters_mutex;
+    std::deque<waiter> m_waiters;
+    std::atomic_size_t m_num_waiters = 0;
+};
+
+class post_or_wait_awaitable {
+public:
+    post_or_wait_awaitable(executor_ptr ex, ufunc<void()> func)
+        : m_ex(std::move(ex))
+        , m_func(std::move(func))
+    {}
+
+    bool await_ready() {
+        auto& b = m_ex->get_bounds();
+        if (b && !b->has_room()) return false;
+        m_ex->post(std::move(m_func));
+        return true;
+    }
+
+    template <typename PromiseType>
+    bool await_suspend(std::coroutine_handle<PromiseType> h) {
+        return m_ex->get_bounds()->wait_for_room(h, h.promise().m_executor);
+    }
+
+    void await_resume() {
+        if (m_func) {
+            m_ex->post(std::move(m_func));
+        }
+    }
+
+private:
+    executor_ptr m_ex;
+    ufunc<void()> m_func;
+};
+
+[[nodiscard]] inline post_or_wait_awaitable post_or_wait(executor_ptr ex, ufunc<void()> func) {
+    return {std::move(ex), std::move(func)};
+}
+
+} // namespace xeq
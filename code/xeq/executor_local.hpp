@@ -0,0 +1,64 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "executor.hpp"
+#include "executor_local_storage.hpp"
+#include <utility>
+
+namespace xeq {
+
+// typed key to a per-executor value: like thread_local, but for executors
+// use it for hot per-worker state (buffers, rngs, caches) which must follow the work and not the thread
+//
+// finding a value is an index into the executor's storage, with no locking, and it's safe while values
+// of other keys are created or reset from other threads (creating or resetting one takes a lock)
+// the values themselves are not synchronized
+// a strand serializes access, so a strand's values are safe to use from its handlers and coroutines
+// a non-strand executor may be run by multiple threads, so its values must be either created before it runs,
+// or be thread-safe and created from a single thread
+//
+// every key takes a global slot which is never reused, so keys should be long-lived (typically globals)
+// there can be at most executor_local_storage::max_slots keys (creating a value for a key beyond that throws)
+// values are destroyed with the executor
+
+template <typename T>
+class executor_local {
+public:
+    executor_local() noexcept : m_slot(executor_local_storage::new_slot()) {}
+
+    executor_local(const executor_local&) = delete;
+    executor_local& operator=(const executor_local&) = delete;
+
+    // default-constructs the value on first access
+    T& get(executor& ex) const {
+        if (auto p = find(ex)) return *p;
+        return emplace(ex);
+    }
+
+    // null if there is no value
+    T* find(executor& ex) const noexcept {
+        return static_cast<T*>(ex.local_storage().get(m_slot));
+    }
+
+    // replaces the value
+    template <typename... Args>
+    T& emplace(executor& ex, Args&&... args) const {
+        auto p = new T(std::forward<Args>(args)...);
+        ex.local_storage().set(m_slot, p, [](void* v) {
+            delete static_cast<T*>(v);
+        });
+        return *p;
+    }
+
+    void reset(executor& ex) const {
+        ex.local_storage().set(m_slot, nullptr, nullptr);
+    }
+
+    uint32_t slot() const noexcept { return m_slot; }
+
+private:
+    uint32_t m_slot;
+};
+
+} // namespace xeq
@@ -0,0 +1,58 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "api.h"
+#include <atomic>
+#include <cstdint>
+
+namespace xeq {
+
+// values of executor_local keys owned by an executor (see executor_local.hpp)
+// indexed by the key slot: no hashing, no locking on get
+// the values are in fixed-size blocks which are only added (under a lock) and never move,
+// so a get is safe while a value for another slot is being set from another thread
+class XEQ_API executor_local_storage {
+public:
+    executor_local_storage() = default;
+    ~executor_local_storage();
+
+    executor_local_storage(const executor_local_storage&) = delete;
+    executor_local_storage& operator=(const executor_local_storage&) = delete;
+
+    using destroy_func = void (*)(void*);
+
+    static constexpr uint32_t block_size = 32;
+    static constexpr uint32_t max_blocks = 128;
+    static constexpr uint32_t max_slots = block_size * max_blocks;
+
+    void* get(uint32_t slot) const noexcept {
+        auto blocks = m_blocks.load(std::memory_order_acquire);
+        if (!blocks || slot >= max_slots) return nullptr;
+        auto block = blocks[slot / block_size].load(std::memory_order_acquire);
+        if (!block) return nullptr;
+        return block[slot % block_size].ptr.load(std::memory_order_acquire);
+    }
+
+    // destroys the previous value in the slot (if any)
+    // throws if the slot is not less than max_slots
+    void set(uint32_t slot, void* ptr, destroy_func destroy);
+
+    // destroys all values
+    void clear() noexcept;
+
+    // slots are global and never reused
+    static uint32_t new_slot() noexcept;
+
+private:
+    struct value {
+        std::atomic<void*> ptr = nullptr;
+        destroy_func destroy = nullptr; // only touched under the lock
+    };
+    using block_ptr = std::atomic<value*>;
+
+    // array of max_blocks, allocated on the first set
+    std::atomic<block_ptr*> m_blocks = nullptr;
+};
+
+} // namespace xeq
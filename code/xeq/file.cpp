@@ -0,0 +1,210 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "file.hpp"
+#include "executor.hpp"
+#include "handler_allocator.hpp"
+#include "offload.hpp"
+
+#include <boost/asio/any_io_executor.hpp>
+
+#if defined(BOOST_ASIO_HAS_FILE)
+#   include <boost/asio/random_access_file.hpp>
+#   include <boost/asio/error.hpp>
+#else
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/stat.h>
+#   include <cerrno>
+#   include <sys/types.h>
+#endif
+
+namespace asio = boost::asio;
+
+namespace xeq {
+
+#if defined(BOOST_ASIO_HAS_FILE)
+
+namespace {
+asio::file_base::flags to_asio_flags(unsigned f) {
+    asio::file_base::flags ret = {};
+    if (f & file::read_only) ret = ret | asio::file_base::read_only;
+    if (f & file::write_only) ret = ret | asio::file_base::write_only;
+    if (f & file::read_write) ret = ret | asio::file_base::read_write;
+    if (f & file::append) ret = ret | asio::file_base::append;
+    if (f & file::create) ret = ret | asio::file_base::create;
+    if (f & file::exclusive) ret = ret | asio::file_base::exclusive;
+    if (f & file::truncate) ret = ret | asio::file_base::truncate;
+    if (f & file::sync_all_on_write) ret = ret | asio::file_base::sync_all_on_write;
+    return ret;
+}
+
+template <typename Cb>
+auto wrap_cb(Cb&& cb) {
+    return with_handler_allocator{[cb = std::forward<Cb>(cb)](const boost::system::error_code& ec, size_t n) mutable {
+        if (ec == asio::error::eof) {
+            cb({}, n);
+        }
+        else {
+            cb(ec, n);
+        }
+    }};
+}
+}
+
+struct file::impl {
+    asio::random_access_file f;
+    explicit impl(const executor_ptr& ex) : f(ex->as_asio_executor()) {}
+};
+
+void file::open(const std::string& path, unsigned open_flags) {
+    boost::system::error_code ec;
+    m_impl->f.open(path, to_asio_flags(open_flags), ec);
+    if (ec) throw std::system_error(ec);
+}
+
+void file::close() {
+    boost::system::error_code ec;
+    m_impl->f.close(ec);
+}
+
+uint64_t file::size() const {
+    boost::system::error_code ec;
+    auto ret = m_impl->f.size(ec);
+    if (ec) throw std::system_error(ec);
+    return ret;
+}
+
+bool file::is_open() const noexcept {
+    return m_impl->f.is_open();
+}
+
+void file::async_read_some_at(uint64_t offset, std::span<std::byte> buf, io_cb cb) {
+    m_impl->f.async_read_some_at(offset, asio::buffer(buf.data(), buf.size()), wrap_cb(std::move(cb)));
+}
+
+void file::async_write_some_at(uint64_t offset, std::span<const std::byte> buf, io_cb cb) {
+    m_impl->f.async_write_some_at(offset, asio::buffer(buf.data(), buf.size()), wrap_cb(std::move(cb)));
+}
+
+#else
+
+// posix fallback: blocking calls on the default offload pool, so that they don't stall the executor
+
+namespace {
+int to_posix_flags(unsigned f) {
+    int ret = 0;
+    if (f & file::read_only) ret |= O_RDONLY;
+    if (f & file::write_only) ret |= O_WRONLY;
+    if (f & file::read_write) ret |= O_RDWR;
+    if (f & file::append) ret |= O_APPEND;
+    if (f & file::create) ret |= O_CREAT;
+    if (f & file::exclusive) ret |= O_EXCL;
+    if (f & file::truncate) ret |= O_TRUNC;
+    if (f & file::sync_all_on_write) ret |= O_SYNC;
+    return ret;
+}
+
+error_code last_error() {
+    return error_code(errno, std::system_category());
+}
+
+// shared with the operations in flight, so that closing the file doesn't close a descriptor which is in use
+// (or worse, which has been reused by the time they run)
+struct posix_fd {
+    int fd;
+    ~posix_fd() {
+        ::close(fd);
+    }
+};
+
+void post_completion(const executor_ptr& ex, file::io_cb cb, error_code ec, size_t n) {
+    ex->post([cb = std::move(cb), ec, n]() mutable {
+        cb(ec, n);
+    });
+}
+
+// Op is the blocking call: ssize_t(int fd)
+template <typename Op>
+void offload_io(const executor_ptr& ex, const std::shared_ptr<posix_fd>& fd, Op op, file::io_cb cb) {
+    if (!fd) {
+        post_completion(ex, std::move(cb), std::make_error_code(std::errc::bad_file_descriptor), 0);
+        return;
+    }
+
+    // shared with the job, so that we can complete it if the pool rejects it
+    struct io_op {
+        executor_ptr ex;
+        std::shared_ptr<posix_fd> fd;
+        Op op;
+        file::io_cb cb;
+    };
+    auto o = std::make_shared<io_op>(io_op{ex, fd, std::move(op), std::move(cb)});
+
+    auto r = offload_pool::default_pool().submit([o] {
+        auto r = o->op(o->fd->fd);
+        if (r < 0) post_completion(o->ex, std::move(o->cb), last_error(), 0);
+        else post_completion(o->ex, std::move(o->cb), {}, size_t(r));
+    });
+    if (r == offload_pool::submit_result::rejected) {
+        post_completion(ex, std::move(o->cb), std::make_error_code(std::errc::resource_unavailable_try_again), 0);
+    }
+}
+}
+
+struct file::impl {
+    std::shared_ptr<posix_fd> fd;
+    explicit impl(const executor_ptr&) {}
+};
+
+void file::open(const std::string& path, unsigned open_flags) {
+    close();
+    // not inherited by child processes, as asio's files aren't
+    auto fd = ::open(path.c_str(), to_posix_flags(open_flags) | O_CLOEXEC, 0644);
+    if (fd < 0) throw std::system_error(last_error());
+    m_impl->fd = std::make_shared<posix_fd>(fd);
+}
+
+void file::close() {
+    m_impl->fd.reset();
+}
+
+uint64_t file::size() const {
+    if (!m_impl->fd) throw std::system_error(std::make_error_code(std::errc::bad_file_descriptor));
+    struct stat st;
+    if (::fstat(m_impl->fd->fd, &st) != 0) throw std::system_error(last_error());
+    return uint64_t(st.st_size);
+}
+
+bool file::is_open() const noexcept {
+    return !!m_impl->fd;
+}
+
+void file::async_read_some_at(uint64_t offset, std::span<std::byte> buf, io_cb cb) {
+    offload_io(m_executor, m_impl->fd, [offset, buf](int fd) {
+        return ::pread(fd, buf.data(), buf.size(), off_t(offset));
+    }, std::move(cb));
+}
+
+void file::async_write_some_at(uint64_t offset, std::span<const std::byte> buf, io_cb cb) {
+    offload_io(m_executor, m_impl->fd, [offset, buf](int fd) {
+        return ::pwrite(fd, buf.data(), buf.size(), off_t(offset));
+    }, std::move(cb));
+}
+
+#endif
+
+file::file(const executor_ptr& ex)
+    : m_executor(ex)
+    , m_impl(std::make_unique<impl>(ex))
+{}
+
+file::file(const executor_ptr& ex, const std::string& path, unsigned open_flags)
+    : file(ex)
+{
+    open(path, open_flags);
+}
+
+file::~file() = default;
+
+} // namespace xeq
@@ -0,0 +1,188 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "api.h"
+#include "coro.hpp"
+#include "executor_ptr.hpp"
+#include "error_code.hpp"
+#include "ufunc.hpp"
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <system_error>
+
+namespace xeq {
+
+// asynchronous random access file
+//
+// completions are dispatched through the executor of the file, so a coroutine awaiting an operation
+// resumes on it (use a strand if the file is shared between coroutines)
+//
+// all operations work on caller-provided buffers: no data is copied by xeq
+// the caller must keep the buffers alive until the operation completes
+//
+// with asio file support (io_uring on Linux, IOCP on Windows) the operations are truly asynchronous
+// without it there is a fallback which performs the blocking calls on the default offload pool (see offload.hpp)
+// and posts the completions to the executor. If the pool rejects an operation, it completes with
+// std::errc::resource_unavailable_try_again
+class XEQ_API file {
+public:
+    enum flags : unsigned {
+        read_only = 1,
+        write_only = 2,
+        read_write = 4,
+        append = 8,
+        create = 16,
+        exclusive = 32,
+        truncate = 64,
+        sync_all_on_write = 128,
+    };
+
+    explicit file(const executor_ptr& ex);
+    file(const executor_ptr& ex, const std::string& path, unsigned open_flags);
+    ~file();
+
+    file(const file&) = delete;
+    file& operator=(const file&) = delete;
+
+    // throw std::system_error on failure
+    void open(const std::string& path, unsigned open_flags);
+    void close();
+    uint64_t size() const;
+
+    bool is_open() const noexcept;
+
+    const executor_ptr& get_executor() const noexcept {
+        return m_executor;
+    }
+
+    // reaching the end of the file is not an error, but a successful completion with zero bytes
+    using io_cb = ufunc<void(const error_code& ec, size_t bytes)>;
+
+    void async_read_some_at(uint64_t offset, std::span<std::byte> buf, io_cb cb);
+    void async_write_some_at(uint64_t offset, std::span<const std::byte> buf, io_cb cb);
+
+    // coroutine interface
+    // the awaitables return the number of bytes transferred and throw std::system_error on error
+
+    struct io_awaitable {
+        error_code ec;
+        size_t bytes = 0;
+        bool await_ready() const noexcept { return false; }
+        size_t await_resume() {
+            if (ec) throw std::system_error(ec);
+            return bytes;
+        }
+    };
+
+    struct read_awaitable : public io_awaitable {
+        file& f;
+        uint64_t offset;
+        std::span<std::byte> buf;
+        read_awaitable(file& f, uint64_t offset, std::span<std::byte> buf) : f(f), offset(offset), buf(buf) {}
+        void await_suspend(std::coroutine_handle<> h) {
+            f.async_read_some_at(offset, buf, [this, h](const error_code& e, size_t n) {
+                ec = e;
+                bytes = n;
+                h.resume();
+            });
+        }
+    };
+
+    struct write_awaitable : public io_awaitable {
+        file& f;
+        uint64_t offset;
+        std::span<const std::byte> buf;
+        write_awaitable(file& f, uint64_t offset, std::span<const std::byte> buf) : f(f), offset(offset), buf(buf) {}
+        void await_suspend(std::coroutine_handle<> h) {
+            f.async_write_some_at(offset, buf, [this, h](const error_code& e, size_t n) {
+                ec = e;
+                bytes = n;
+                h.resume();
+            });
+        }
+    };
+
+    [[nodiscard]] read_awaitable read_some_at(uint64_t offset, std::span<std::byte> buf) {
+        return {*this, offset, buf};
+    }
+    [[nodiscard]] write_awaitable write_some_at(uint64_t offset, std::span<const std::byte> buf) {
+        return {*this, offset, buf};
+    }
+
+    struct impl;
+private:
+    executor_ptr m_executor;
+    std::unique_ptr<impl> m_impl;
+};
+
+// read until the buffer is full or the end of the file is reached
+// returns the number of bytes read
+inline coro<size_t> read_at(file& f, uint64_t offset, std::span<std::byte> buf) {
+    size_t total = 0;
+    while (total < buf.size()) {
+        auto n = co_await f.read_some_at(offset + total, buf.subspan(total));
+        if (n == 0) break; // eof
+        total += n;
+    }
+    co_return total;
+}
+
+// write the entire buffer
+// throws std::system_error on error, including std::errc::io_error if a write makes no progress
+inline coro<void> write_at(file& f, uint64_t offset, std::span<const std::byte> buf) {
+    size_t total = 0;
+    while (total < buf.size()) {
+        auto n = co_await f.write_some_at(offset + total, buf.subspan(total));
+        if (n == 0) throw std::system_error(std::make_error_code(std::errc::io_error));
+        total += n;
+    }
+}
+
+// stream the file in chunks through a single reusable buffer
+// each yielded span points into the buffer and is only valid until the next chunk is requested
+// works with co_for:
+//    co_for(chunk, read_chunks(f, buf)) { consume(*chunk); }
+inline generator<std::span<const std::byte>> read_chunks(file& f, std::span<std::byte> buffer, uint64_t offset = 0) {
+    while (true) {
+        auto n = co_await read_at(f, offset, buffer);
+        if (n == 0) co_return;
+        offset += n;
+        co_yield std::span<const std::byte>(buffer.data(), n);
+        if (n < buffer.size()) co_return; // eof
+    }
+}
+
+// sequential access on top of a file
+class file_stream {
+    file& m_file;
+    uint64_t m_pos;
+public:
+    explicit file_stream(file& f, uint64_t pos = 0) : m_file(f), m_pos(pos) {}
+
+    uint64_t pos() const noexcept { return m_pos; }
+    void seek(uint64_t pos) noexcept { m_pos = pos; }
+
+    coro<size_t> read_some(std::span<std::byte> buf) {
+        auto n = co_await m_file.read_some_at(m_pos, buf);
+        m_pos += n;
+        co_return n;
+    }
+
+    coro<size_t> read(std::span<std::byte> buf) {
+        auto n = co_await read_at(m_file, m_pos, buf);
+        m_pos += n;
+        co_return n;
+    }
+
+    coro<void> write(std::span<const std::byte> buf) {
+        co_await write_at(m_file, m_pos, buf);
+        m_pos += buf.size();
+    }
+};
+
+} // namespace xeq
@@ -0,0 +1,240 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "handler_allocator.hpp"
+#include <atomic>
+#include <cstdint>
+#include <new>
+
+namespace xeq {
+
+namespace {
+
+constexpr size_t min_class_size = 64;
+constexpr size_t num_classes = 5; // 64, 128, 256, 512, 1024
+constexpr size_t max_class_size = min_class_size << (num_classes - 1);
+constexpr uint32_t max_cached_per_class = 256;
+
+struct free_block {
+    free_block* next;
+};
+
+// blocks which are freed by other threads are returned to the thread which allocated them
+// the state outlives its thread if some of its blocks are still in use when it exits
+// then it's deleted by whoever returns the last of them
+struct thread_state {
+    // lock-free stacks of blocks freed by other threads (or closed, once the thread has exited)
+    std::atomic<free_block*> remote[num_classes] = {};
+
+    // once the thread has exited: the number of blocks which are still to be returned
+    std::atomic_int64_t orphans = 0;
+};
+
+free_block* const closed = reinterpret_cast<free_block*>(uintptr_t(1));
+
+// every cacheable block is prefixed with its owner (null if it's not to be cached)
+// the prefix keeps the default new alignment of the block
+struct block_header {
+    thread_state* owner;
+};
+constexpr size_t header_size = alignof(std::max_align_t) > sizeof(block_header)
+    ? alignof(std::max_align_t) : sizeof(block_header);
+
+// trivially destructible, so that it's still usable after the cleaner below has been destroyed
+// (blocks may be freed by other thread_local destructors at thread exit)
+struct thread_cache {
+    free_block* heads[num_classes];
+    uint32_t counts[num_classes];
+    bool disabled;
+    thread_state* state; // created on the first cacheable allocation
+    int64_t blocks_out; // allocated by this thread and not returned
+    handler_memory_stats stats;
+};
+
+thread_local thread_cache t_cache;
+
+void release_orphans(thread_state* state, int64_t n) noexcept {
+    if (state->orphans.fetch_add(n, std::memory_order_acq_rel) + n == 0) {
+        delete state;
+    }
+}
+
+struct thread_cache_cleaner {
+    ~thread_cache_cleaner() {
+        t_cache.disabled = true;
+        for (size_t i = 0; i < num_classes; ++i) {
+            auto b = t_cache.heads[i];
+            while (b) {
+                auto next = b->next;
+                ::operator delete(b);
+                b = next;
+            }
+            t_cache.heads[i] = nullptr;
+            t_cache.counts[i] = 0;
+        }
+        t_cache.stats.cached_blocks = 0;
+
+        auto state = std::exchange(t_cache.state, nullptr);
+        if (!state) return;
+        for (auto& r : state->remote) {
+            auto b = r.exchange(closed, std::memory_order_acquire);
+            while (b) {
+                auto next = b->next;
+                ::operator delete(b);
+                --t_cache.blocks_out;
+                b = next;
+            }
+        }
+        // blocks returned after this are deleted by the thread which frees them (see below)
+        release_orphans(state, std::exchange(t_cache.blocks_out, 0));
+    }
+    void touch() {}
+};
+
+thread_local thread_cache_cleaner t_cleaner;
+
+// returns num_classes if the size is not cacheable
+size_t size_class(size_t size) {
+    if (size > max_class_size - header_size) return num_classes;
+    size_t c = 0;
+    size_t cs = min_class_size;
+    while (cs < size + header_size) {
+        cs <<= 1;
+        ++c;
+    }
+    return c;
+}
+
+// takes the blocks which other threads have returned
+// returns the number of blocks
+uint32_t take_remote(thread_cache& cache, size_t c) noexcept {
+    auto& r = cache.state->remote[c];
+    if (!r.load(std::memory_order_relaxed)) return 0;
+    auto b = r.exchange(nullptr, std::memory_order_acquire);
+    uint32_t n = 0;
+    while (b) {
+        auto next = b->next;
+        b->next = cache.heads[c];
+        cache.heads[c] = b;
+        b = next;
+        ++n;
+    }
+    return n;
+}
+
+void* with_owner(void* p, thread_state* owner) noexcept {
+    static_cast<block_header*>(p)->owner = owner;
+    return static_cast<char*>(p) + header_size;
+}
+
+} // namespace
+
+void* handler_memory_allocate(size_t size, size_t align) {
+    auto& cache = t_cache;
+    ++cache.stats.allocations;
+
+    if (align > alignof(std::max_align_t)) {
+        ++cache.stats.heap_allocations;
+        return ::operator new(size, std::align_val_t(align));
+    }
+
+    auto c = size_class(size);
+    if (c == num_classes) {
+        ++cache.stats.heap_allocations;
+        return ::operator new(size);
+    }
+
+    if (cache.disabled) [[unlikely]] {
+        // the thread is exiting, so nobody would take the block back
+        ++cache.stats.heap_allocations;
+        return with_owner(::operator new(min_class_size << c), nullptr);
+    }
+
+    if (!cache.state) [[unlikely]] {
+        t_cleaner.touch(); // make sure the cleaner is constructed for this thread
+        cache.state = new thread_state;
+    }
+
+    if (!cache.heads[c]) {
+        if (auto n = take_remote(cache, c)) {
+            cache.counts[c] += n;
+            cache.stats.cached_blocks += n;
+            cache.blocks_out -= n;
+        }
+    }
+
+    ++cache.blocks_out;
+    if (auto b = cache.heads[c]) {
+        cache.heads[c] = b->next;
+        --cache.counts[c];
+        --cache.stats.cached_blocks;
+        ++cache.stats.cache_hits;
+        return with_owner(b, cache.state);
+    }
+
+    ++cache.stats.heap_allocations;
+    return with_owner(::operator new(min_class_size << c), cache.state);
+}
+
+void handler_memory_deallocate(void* p, size_t size, size_t align) noexcept {
+    auto& cache = t_cache;
+    ++cache.stats.deallocations;
+
+    if (align > alignof(std::max_align_t)) {
+        ++cache.stats.heap_deallocations;
+        ::operator delete(p, std::align_val_t(align));
+        return;
+    }
+
+    auto c = size_class(size);
+    if (c == num_classes) {
+        ++cache.stats.heap_deallocations;
+        ::operator delete(p);
+        return;
+    }
+
+    auto raw = static_cast<char*>(p) - header_size;
+    auto owner = reinterpret_cast<block_header*>(raw)->owner;
+    auto b = reinterpret_cast<free_block*>(raw);
+
+    if (!owner) {
+        ++cache.stats.heap_deallocations;
+        ::operator delete(raw);
+        return;
+    }
+
+    if (owner != cache.state) {
+        // return it to the thread which allocated it
+        ++cache.stats.remote_deallocations;
+        auto& r = owner->remote[c];
+        auto head = r.load(std::memory_order_relaxed);
+        do {
+            if (head == closed) {
+                // the owner has exited
+                ::operator delete(raw);
+                release_orphans(owner, -1);
+                return;
+            }
+            b->next = head;
+        } while (!r.compare_exchange_weak(head, b, std::memory_order_release, std::memory_order_relaxed));
+        return;
+    }
+
+    --cache.blocks_out;
+    if (cache.counts[c] == max_cached_per_class) {
+        ++cache.stats.heap_deallocations;
+        ::operator delete(raw);
+        return;
+    }
+
+    b->next = cache.heads[c];
+    cache.heads[c] = b;
+    ++cache.counts[c];
+    ++cache.stats.cached_blocks;
+}
+
+handler_memory_stats this_thread_handler_memory_stats() noexcept {
+    return t_cache.stats;
+}
+
+} // namespace xeq
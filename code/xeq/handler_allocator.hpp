@@ -0,0 +1,77 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "api.h"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace xeq {
+
+// recycling allocator for asio handler operations
+//
+// blocks are cached per thread in power-of-two size classes (64 to 1024 bytes, up to 256 blocks per class)
+// larger or over-aligned blocks go straight to the heap
+// every cached block is prefixed with the thread which allocated it (16 bytes of the size class)
+// a block freed on a different thread is returned to that thread (with a lock-free push), so a thread which posts
+// to handlers which run on other threads gets its blocks back too
+//
+// all handlers which xeq posts to asio (posts, coroutine resumes, timer waits) are associated with it
+// so in a steady state xeq does no heap allocations for asio operations
+
+XEQ_API void* handler_memory_allocate(size_t size, size_t align);
+XEQ_API void handler_memory_deallocate(void* p, size_t size, size_t align) noexcept;
+
+struct handler_memory_stats {
+    uint64_t allocations;
+    uint64_t cache_hits; // allocations served from the cache
+    uint64_t heap_allocations; // allocations which went to the heap
+    uint64_t deallocations;
+    uint64_t heap_deallocations; // deallocations which went to the heap (cache full or block not cacheable)
+    uint64_t remote_deallocations; // deallocations of blocks which were returned to the thread which allocated them
+    uint64_t cached_blocks; // blocks currently in the cache
+};
+
+// counters for the calling thread
+XEQ_API handler_memory_stats this_thread_handler_memory_stats() noexcept;
+
+template <typename T>
+class handler_allocator {
+public:
+    using value_type = T;
+
+    handler_allocator() noexcept = default;
+    template <typename U>
+    handler_allocator(const handler_allocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(handler_memory_allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        handler_memory_deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    template <typename U>
+    bool operator==(const handler_allocator<U>&) const noexcept { return true; }
+};
+
+// wrap a handler, so that asio allocates its operation with handler_allocator
+template <typename Handler>
+struct with_handler_allocator {
+    Handler handler;
+
+    using allocator_type = handler_allocator<void>;
+    allocator_type get_allocator() const noexcept { return {}; }
+
+    template <typename... Args>
+    void operator()(Args&&... args) {
+        handler(std::forward<Args>(args)...);
+    }
+};
+
+template <typename Handler>
+with_handler_allocator(Handler) -> with_handler_allocator<Handler>;
+
+} // namespace xeq
@@ -0,0 +1,82 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+// private header: only include from xeq translation units
+
+#include "../memory_account.hpp"
+#include "../handler_allocator.hpp"
+#include <utility>
+
+namespace xeq::impl {
+
+#if XEQ_FRAME_ACCOUNTING
+// coroutine frames allocated on this thread are charged to the current account (if any)
+// returns the previous one
+const memory_account_ptr* set_current_memory_account(const memory_account_ptr* acct) noexcept;
+#endif
+
+// handler_allocator which charges the allocations to an account
+template <typename T>
+class accounted_allocator {
+public:
+    using value_type = T;
+
+    accounted_allocator(memory_account_ptr acct, memory_account::category c) noexcept
+        : m_account(std::move(acct))
+        , m_category(c)
+    {}
+    template <typename U>
+    accounted_allocator(const accounted_allocator<U>& other) noexcept
+        : m_account(other.m_account)
+        , m_category(other.m_category)
+    {}
+
+    T* allocate(size_t n) {
+        auto p = static_cast<T*>(handler_memory_allocate(n * sizeof(T), alignof(T)));
+        m_account->charge(m_category, n * sizeof(T));
+        return p;
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        m_account->discharge(m_category, n * sizeof(T));
+        handler_memory_deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    template <typename U>
+    bool operator==(const accounted_allocator<U>& other) const noexcept { return m_account == other.m_account; }
+
+    // a shared_ptr, as asio may destroy the handler before it deallocates its operation
+    memory_account_ptr m_account;
+    memory_account::category m_category;
+};
+
+// used instead of with_handler_allocator by executors which have an account
+// the operation is charged to the account and so are the coroutine frames allocated while the handler runs
+template <typename Handler>
+struct accounted_handler {
+    Handler handler;
+    memory_account_ptr account;
+    memory_account::category category = memory_account::category::handlers;
+
+    using allocator_type = accounted_allocator<void>;
+    allocator_type get_allocator() const noexcept { return {account, category}; }
+
+    template <typename... Args>
+    void operator()(Args&&... args) {
+#if XEQ_FRAME_ACCOUNTING
+        struct scope {
+            const memory_account_ptr* prev;
+            ~scope() { set_current_memory_account(prev); }
+        } s{set_current_memory_account(&account)};
+#endif
+        handler(std::forward<Args>(args)...);
+    }
+};
+
+template <typename Handler>
+accounted_handler(Handler, memory_account_ptr) -> accounted_handler<Handler>;
+template <typename Handler>
+accounted_handler(Handler, memory_account_ptr, memory_account::category) -> accounted_handler<Handler>;
+
+} // namespace xeq::impl
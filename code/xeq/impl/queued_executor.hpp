@@ -0,0 +1,230 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+// private header: only include from xeq translation units as it requires asio
+
+#include "../executor.hpp"
+#include "../handler_allocator.hpp"
+#include "../trace.hpp"
+#include "../executor_bounds.hpp"
+#include "accounted_handler.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/execution.hpp>
+#include <boost/asio/require.hpp>
+#include <boost/asio/query.hpp>
+
+#include <itlib/shared_from.hpp>
+
+// executors which don't post directly to an io_context, but to a custom queue which later dispatches to it
+//
+// Queue must provide:
+// * key_type - the scheduling key of an executor (priority level, deadline...)
+// * void push(const key_type&, ufunc<void()>)
+// * io_context::executor_type m_aexec - the underlying context executor
+
+namespace xeq::impl {
+
+namespace asio = boost::asio;
+
+// a standard asio executor which executes through the queue
+// Inner is an io_context executor which provides the context and work tracking
+template <typename Queue, typename Inner = asio::io_context::executor_type>
+class queued_asio_executor {
+public:
+    using key_type = typename Queue::key_type;
+
+    queued_asio_executor(std::shared_ptr<Queue> queue, key_type key, Inner inner)
+        : m_queue(std::move(queue))
+        , m_key(std::move(key))
+        , m_inner(std::move(inner))
+    {}
+
+    template <typename F>
+    void execute(F&& f) const {
+        m_queue->push(m_key, std::forward<F>(f));
+    }
+
+    asio::execution_context& query(asio::execution::context_t) const noexcept {
+        return asio::query(m_inner, asio::execution::context);
+    }
+
+    static constexpr asio::execution::blocking_t query(asio::execution::blocking_t) noexcept {
+        return asio::execution::blocking.never;
+    }
+
+    queued_asio_executor require(asio::execution::blocking_t::never_t) const {
+        return *this;
+    }
+
+    auto require(asio::execution::outstanding_work_t::tracked_t t) const {
+        return rewrap(asio::require(m_inner, t));
+    }
+
+    auto require(asio::execution::outstanding_work_t::untracked_t t) const {
+        return rewrap(asio::require(m_inner, t));
+    }
+
+    friend bool operator==(const queued_asio_executor& a, const queued_asio_executor& b) noexcept {
+        return a.m_queue == b.m_queue && a.m_key == b.m_key;
+    }
+    friend bool operator!=(const queued_asio_executor& a, const queued_asio_executor& b) noexcept {
+        return !(a == b);
+    }
+
+private:
+    template <typename I>
+    queued_asio_executor<Queue, I> rewrap(I inner) const {
+        return {m_queue, m_key, std::move(inner)};
+    }
+
+    template <typename, typename>
+    friend class queued_asio_executor;
+
+    std::shared_ptr<Queue> m_queue;
+    key_type m_key;
+    Inner m_inner;
+};
+
+// the post path shared by the queued executors, as in the context executors:
+// tracing and bounds wrap the function, then it's dispatched with the memory account or as it is
+// Derived must provide void dispatch(Handler&&) which sends the handler to the queue
+// and void dispatch_plain(F&&) for functions with no memory account, which adds an allocator where it's used
+template <typename Derived, typename Base>
+class queued_executor_base : public Base, public itlib::enable_shared_from {
+public:
+    virtual void post(ufunc<void()> func) override {
+        if (trace::enabled()) [[unlikely]] {
+            func = trace::traced_post(this, std::move(func));
+        }
+        if (auto& b = this->get_bounds()) [[unlikely]] {
+            func = b->track(std::move(func));
+        }
+        dispatch_handler(std::move(func));
+    }
+
+    virtual void post_resume(std::coroutine_handle<> handle) override {
+        if (trace::enabled() || this->get_bounds()) [[unlikely]] {
+            return post([=] { handle.resume(); });
+        }
+        dispatch_handler([=]() { handle.resume(); });
+    }
+
+    virtual void post_call(void (*func)(void*), void* arg) override {
+        if (trace::enabled() || this->get_bounds()) [[unlikely]] {
+            return post([=] { func(arg); });
+        }
+        dispatch_handler([=]() { func(arg); });
+    }
+
+private:
+    template <typename F>
+    void dispatch_handler(F&& f) {
+        auto& self = static_cast<Derived&>(*this);
+        if (auto& acct = this->get_memory_account()) [[unlikely]] {
+            return self.dispatch(impl::accounted_handler{std::forward<F>(f), acct});
+        }
+        self.dispatch_plain(std::forward<F>(f));
+    }
+};
+
+// the handlers are pushed to the queue directly
+// with a memory account, the coroutine frames allocated by them are charged to it, but not the queue nodes
+template <typename Queue>
+class queued_executor final : public queued_executor_base<queued_executor<Queue>, executor> {
+public:
+    using key_type = typename Queue::key_type;
+
+    std::shared_ptr<Queue> m_queue;
+    key_type m_key;
+
+    queued_executor(std::shared_ptr<Queue> queue, key_type key)
+        : m_queue(std::move(queue))
+        , m_key(std::move(key))
+    {}
+
+    template <typename Handler>
+    void dispatch(Handler&& h) {
+        m_queue->push(m_key, std::forward<Handler>(h));
+    }
+
+    // the queue stores type-erased functions, which don't use the associated allocator
+    template <typename F>
+    void dispatch_plain(F&& f) {
+        dispatch(std::forward<F>(f));
+    }
+
+    virtual bool is_strand() const noexcept override { return false; }
+
+    virtual executor_ptr get_super_executor() noexcept override {
+        return this->shared_from(this);
+    }
+
+    queued_asio_executor<Queue> as_queued_asio_executor() const {
+        return {m_queue, m_key, m_queue->m_aexec};
+    }
+
+    boost::asio::any_io_executor as_asio_executor() noexcept override {
+        return as_queued_asio_executor();
+    }
+
+    strand_ptr make_strand() override;
+
+    virtual bool running_in_this_thread() const noexcept override {
+        return m_queue->m_aexec.running_in_this_thread();
+    }
+};
+
+// the handlers go through an asio strand on top of the queue, so its operations are allocated through
+// the associated allocator of the handler (and charged to the memory account, if any)
+template <typename Queue>
+class queued_strand final : public queued_executor_base<queued_strand<Queue>, strand> {
+public:
+    using asio_strand = asio::strand<queued_asio_executor<Queue>>;
+    asio_strand m_astrand;
+    executor_ptr m_super;
+
+    queued_strand(asio_strand&& s, executor_ptr super)
+        : m_astrand(std::move(s))
+        , m_super(std::move(super))
+    {}
+
+    template <typename Handler>
+    void dispatch(Handler&& h) {
+        asio::post(m_astrand, std::forward<Handler>(h));
+    }
+
+    template <typename F>
+    void dispatch_plain(F&& f) {
+        dispatch(with_handler_allocator{std::forward<F>(f)});
+    }
+
+    executor_ptr get_super_executor() noexcept override {
+        return m_super;
+    }
+
+    boost::asio::any_io_executor as_asio_executor() noexcept override {
+        return m_astrand;
+    }
+
+    strand_ptr make_strand() override {
+        return this->shared_from(this);
+    }
+
+    virtual bool running_in_this_thread() const noexcept override {
+        return m_astrand.running_in_this_thread();
+    }
+};
+
+template <typename Queue>
+strand_ptr queued_executor<Queue>::make_strand() {
+    auto ret = std::make_shared<queued_strand<Queue>>(asio::make_strand(as_queued_asio_executor()), this->shared_from(this));
+    ret->set_memory_account(this->get_memory_account());
+    return ret;
+}
+
+} // namespace xeq::impl
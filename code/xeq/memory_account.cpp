@@ -0,0 +1,109 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "memory_account.hpp"
+#include "coro.hpp"
+#include "impl/accounted_handler.hpp"
+
+#include <new>
+
+namespace xeq {
+
+int64_t memory_account::counter::add(int64_t bytes) noexcept {
+    const auto cur = current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    if (bytes > 0) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        auto p = peak.load(std::memory_order_relaxed);
+        while (cur > p && !peak.compare_exchange_weak(p, cur, std::memory_order_relaxed));
+    }
+    return cur;
+}
+
+memory_account::usage memory_account::counter::get() const noexcept {
+    return {
+        current.load(std::memory_order_relaxed),
+        peak.load(std::memory_order_relaxed),
+        allocations.load(std::memory_order_relaxed),
+    };
+}
+
+memory_account::memory_account(memory_account_ptr parent)
+    : m_parent(std::move(parent))
+{}
+
+memory_account::~memory_account() = default;
+
+void memory_account::charge(category c, size_t bytes) noexcept {
+    m_categories[size_t(c)].add(int64_t(bytes));
+    const auto cur = m_total.add(int64_t(bytes));
+    if (m_soft_limit && cur > m_soft_limit && !m_over_limit.exchange(true)) {
+        m_on_exceeded(*this);
+    }
+    if (m_parent) m_parent->charge(c, bytes);
+}
+
+void memory_account::discharge(category c, size_t bytes) noexcept {
+    m_categories[size_t(c)].add(-int64_t(bytes));
+    const auto cur = m_total.add(-int64_t(bytes));
+    if (cur <= m_soft_limit && m_over_limit.load(std::memory_order_relaxed)) {
+        m_over_limit.store(false);
+    }
+    if (m_parent) m_parent->discharge(c, bytes);
+}
+
+memory_account::snapshot memory_account::get_snapshot() const noexcept {
+    snapshot ret;
+    ret.total = m_total.get();
+    for (size_t i = 0; i < num_categories; ++i) {
+        ret.categories[i] = m_categories[i].get();
+    }
+    return ret;
+}
+
+void memory_account::set_soft_limit(size_t bytes, ufunc<void(const memory_account&)> on_exceeded) {
+    m_soft_limit = int64_t(bytes);
+    m_on_exceeded = std::move(on_exceeded);
+}
+
+namespace impl {
+
+#if XEQ_FRAME_ACCOUNTING
+namespace {
+thread_local const memory_account_ptr* t_current_account = nullptr;
+
+// the frame is prefixed with the account it's charged to (null if none)
+// the prefix keeps the default new alignment of the frame
+constexpr size_t frame_prefix_size = __STDCPP_DEFAULT_NEW_ALIGNMENT__ > sizeof(memory_account_ptr)
+    ? __STDCPP_DEFAULT_NEW_ALIGNMENT__ : sizeof(memory_account_ptr);
+}
+
+const memory_account_ptr* set_current_memory_account(const memory_account_ptr* acct) noexcept {
+    return std::exchange(t_current_account, acct);
+}
+
+void* coro_frame_allocate(size_t size) {
+    auto p = static_cast<char*>(::operator new(size + frame_prefix_size));
+    if (auto acct = t_current_account; acct && *acct) [[unlikely]] {
+        (*acct)->charge(memory_account::category::frames, size);
+        new (p) memory_account_ptr(*acct);
+    }
+    else {
+        new (p) memory_account_ptr();
+    }
+    return p + frame_prefix_size;
+}
+
+void coro_frame_deallocate(void* frame, size_t size) noexcept {
+    auto p = static_cast<char*>(frame) - frame_prefix_size;
+    auto acct = std::launder(reinterpret_cast<memory_account_ptr*>(p));
+    if (*acct) [[unlikely]] {
+        (*acct)->discharge(memory_account::category::frames, size);
+    }
+    acct->~memory_account_ptr();
+    ::operator delete(p);
+}
+#endif
+
+} // namespace impl
+
+} // namespace xeq
@@ -0,0 +1,94 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "api.h"
+#include "ufunc.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace xeq {
+
+// opt-in memory accounting for the allocation paths of an executor
+//
+// auto& acct = ctx.enable_memory_accounting();
+// acct->set_soft_limit(64 * 1024 * 1024, [](const memory_account& a) { shed_load(); });
+//
+// when an executor has an account, it attributes to it:
+// * frames: coroutine frames allocated while running its handlers
+//   only if xeq is built with the XEQ_FRAME_ACCOUNTING cmake option (off by default), as every frame is then
+//   prefixed with the account it's charged to. Otherwise nothing is charged to this category
+// * handlers: asio operations for handlers posted to it (post, post_resume, post_call)
+// * timers: timers created with it and their pending waits
+// queued handlers are charged when posted and discharged when they run, so the current value includes
+// everything which is waiting in the executor's queue
+//
+// an account can have a parent to which everything is also charged (say a strand with its own account
+// under its context's account)
+// the soft limit callback is called on the thread which crosses the limit and is not called again
+// until the usage drops back to the limit
+
+class memory_account;
+using memory_account_ptr = std::shared_ptr<memory_account>;
+
+class XEQ_API memory_account {
+public:
+    enum class category {
+        frames,
+        handlers,
+        timers,
+    };
+    static constexpr size_t num_categories = 3;
+
+    struct usage {
+        int64_t current; // bytes
+        int64_t peak;
+        uint64_t allocations;
+    };
+
+    struct snapshot {
+        usage total;
+        usage categories[num_categories];
+
+        const usage& operator[](category c) const noexcept { return categories[size_t(c)]; }
+    };
+
+    explicit memory_account(memory_account_ptr parent = {});
+    ~memory_account();
+
+    memory_account(const memory_account&) = delete;
+    memory_account& operator=(const memory_account&) = delete;
+
+    const memory_account_ptr& parent() const noexcept { return m_parent; }
+
+    void charge(category c, size_t bytes) noexcept;
+    void discharge(category c, size_t bytes) noexcept;
+
+    snapshot get_snapshot() const noexcept;
+
+    // set it before the account is in use
+    // 0 means no limit
+    void set_soft_limit(size_t bytes, ufunc<void(const memory_account&)> on_exceeded);
+
+private:
+    struct counter {
+        std::atomic_int64_t current = 0;
+        std::atomic_int64_t peak = 0;
+        std::atomic_uint64_t allocations = 0;
+
+        int64_t add(int64_t bytes) noexcept;
+        usage get() const noexcept;
+    };
+
+    const memory_account_ptr m_parent;
+    counter m_total;
+    counter m_categories[num_categories];
+
+    int64_t m_soft_limit = 0;
+    ufunc<void(const memory_account&)> m_on_exceeded;
+    std::atomic_bool m_over_limit = false;
+};
+
+} // namespace xeq
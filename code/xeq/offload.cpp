@@ -0,0 +1,144 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "offload.hpp"
+#include "thread_name.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace xeq {
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+class offload_pool_impl final : public offload_pool {
+public:
+    explicit offload_pool_impl(config&& cfg)
+        : m_config(std::move(cfg))
+    {
+        const auto n = m_config.num_threads ? m_config.num_threads : 1;
+        m_threads.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            m_threads.push_back(std::thread([this, i, n]() {
+                if (!m_config.name.empty()) {
+                    if (n == 1) {
+                        set_this_thread_name(m_config.name);
+                    }
+                    else {
+                        set_this_thread_name(m_config.name + ':' + std::to_string(i));
+                    }
+                }
+                work();
+            }));
+        }
+    }
+
+    ~offload_pool_impl() {
+        {
+            std::lock_guard l(m_mutex);
+            m_stopping = true;
+        }
+        m_cv.notify_all();
+        for (auto& t : m_threads) {
+            t.join();
+        }
+    }
+
+    virtual submit_result submit(ufunc<void()> job) override {
+        {
+            std::unique_lock l(m_mutex);
+            ++m_stats.submitted;
+            if (m_queue.size() >= m_config.max_queued) {
+                if (m_config.on_overflow == overflow_policy::reject) {
+                    ++m_stats.rejected;
+                    return submit_result::rejected;
+                }
+                ++m_stats.ran_inline;
+                l.unlock();
+                job();
+                return submit_result::ran_inline;
+            }
+            m_queue.push_back({std::move(job), clock_type::now()});
+            if (m_queue.size() > m_stats.peak_queued) {
+                m_stats.peak_queued = m_queue.size();
+            }
+        }
+        m_cv.notify_one();
+        return submit_result::queued;
+    }
+
+    virtual stats get_stats() const override {
+        std::lock_guard l(m_mutex);
+        auto ret = m_stats;
+        ret.queued = m_queue.size();
+        return ret;
+    }
+
+private:
+    struct queued_job {
+        ufunc<void()> func;
+        clock_type::time_point submitted;
+    };
+
+    void work() {
+        std::unique_lock l(m_mutex);
+        while (true) {
+            m_cv.wait(l, [&] { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) return; // stopping and nothing left to do
+
+            auto job = std::move(m_queue.front());
+            m_queue.pop_front();
+
+            const auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - job.submitted);
+            m_stats.total_queue_wait += wait;
+            if (wait > m_stats.max_queue_wait) m_stats.max_queue_wait = wait;
+            ++m_stats.active;
+
+            l.unlock();
+            bool failed = false;
+            try {
+                job.func();
+            }
+            catch (...) {
+                // nobody to report it to, and the worker must go on
+                failed = true;
+            }
+            job.func = nullptr; // destroy captures outside of the lock
+            l.lock();
+
+            --m_stats.active;
+            ++m_stats.completed;
+            if (failed) ++m_stats.failed;
+        }
+    }
+
+    const config m_config;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<queued_job> m_queue;
+    bool m_stopping = false;
+    stats m_stats = {};
+
+    std::vector<std::thread> m_threads;
+};
+
+} // namespace
+
+offload_pool::~offload_pool() = default; // export vtable
+
+offload_pool_ptr offload_pool::create(config cfg) {
+    return std::make_shared<offload_pool_impl>(std::move(cfg));
+}
+
+offload_pool& offload_pool::default_pool() {
+    static offload_pool_impl pool{config{}};
+    return pool;
+}
+
+} // namespace xeq
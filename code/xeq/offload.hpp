@@ -0,0 +1,161 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "api.h"
+#include "coro.hpp"
+#include "executor.hpp"
+#include "ufunc.hpp"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace xeq {
+
+// a bounded pool of threads for blocking calls (compression, getaddrinfo, synchronous file APIs...)
+// which would otherwise stall everything queued behind them on a context
+//
+// auto r = co_await offload(pool, f); runs f on the pool and resumes the coroutine on its executor
+// the result of f (or the exception it threw) is delivered as a coro_result, which co_await unwraps and
+// co_await offload(...).safe_result() returns as is
+//
+// when max_queued jobs are already waiting, the overflow policy decides:
+// * reject: the job doesn't run and the awaiting coroutine gets offload_rejected
+// * caller_runs: the job runs on the submitting thread, thus slowing down the producers (backpressure)
+
+class offload_pool;
+using offload_pool_ptr = std::shared_ptr<offload_pool>;
+
+class offload_rejected : public std::runtime_error {
+public:
+    offload_rejected() : std::runtime_error("xeq::offload: queue is full") {}
+};
+
+class XEQ_API offload_pool {
+public:
+    enum class overflow_policy {
+        reject,
+        caller_runs,
+    };
+
+    struct config {
+        size_t num_threads = 4;
+        size_t max_queued = 1024;
+        overflow_policy on_overflow = overflow_policy::reject;
+        std::string name = "xeq-offload"; // threads are named name:i
+    };
+
+    struct stats {
+        uint64_t submitted;
+        uint64_t completed; // on the pool
+        uint64_t failed; // completed jobs which threw
+        uint64_t rejected;
+        uint64_t ran_inline; // caller_runs overflows
+        size_t queued;
+        size_t peak_queued;
+        size_t active; // jobs being executed right now
+        std::chrono::nanoseconds total_queue_wait; // time from submit to start of completed jobs
+        std::chrono::nanoseconds max_queue_wait;
+    };
+
+    virtual ~offload_pool();
+
+    offload_pool(const offload_pool&) = delete;
+    offload_pool& operator=(const offload_pool&) = delete;
+
+    // the pool finishes all queued jobs before it's destroyed
+    static offload_pool_ptr create(config cfg);
+    static offload_pool_ptr create() { return create(config{}); }
+
+    // lazily created on first use with the default config
+    static offload_pool& default_pool();
+
+    enum class submit_result {
+        queued,
+        ran_inline,
+        rejected,
+    };
+    // an exception thrown by a job which runs on the pool is dropped and counted in stats::failed
+    // one thrown by a job which runs inline (caller_runs) propagates from submit
+    virtual submit_result submit(ufunc<void()> job) = 0;
+
+    virtual stats get_stats() const = 0;
+
+protected:
+    offload_pool() = default;
+};
+
+template <typename F, bool Safe = false>
+class offload_awaitable {
+public:
+    using value_type = std::invoke_result_t<F&>;
+
+    offload_awaitable(offload_pool& pool, F f)
+        : m_pool(pool)
+        , m_func(std::move(f))
+    {}
+
+    [[nodiscard]] offload_awaitable<F, true> safe_result() && {
+        return {m_pool, std::move(m_func)};
+    }
+
+    // awaitable interface
+    bool await_ready() const noexcept { return false; }
+
+    template <typename PromiseType>
+    bool await_suspend(std::coroutine_handle<PromiseType> h) {
+        auto r = m_pool.submit([this, h, ex = h.promise().m_executor]() {
+            try {
+                if constexpr (std::is_void_v<value_type>) {
+                    m_func();
+                    m_result = coro_result<void>();
+                }
+                else {
+                    m_result = m_func();
+                }
+            }
+            catch (...) {
+                m_result = itlib::unexpected(std::current_exception());
+            }
+            ex->post_resume(h);
+        });
+        if (r == offload_pool::submit_result::rejected) {
+            m_result = itlib::unexpected(std::make_exception_ptr(offload_rejected()));
+            return false;
+        }
+        // don't touch this from here on: the coroutine may already be resumed on another thread
+        return true;
+    }
+
+    auto await_resume() noexcept(Safe) {
+        if constexpr (Safe) {
+            return std::move(m_result);
+        }
+        else if (m_result) {
+            return std::move(m_result).value();
+        }
+        else {
+            std::rethrow_exception(m_result.error());
+        }
+    }
+
+private:
+    offload_pool& m_pool;
+    F m_func;
+    coro_result<value_type> m_result = itlib::unexpected();
+};
+
+template <typename F>
+[[nodiscard]] offload_awaitable<std::decay_t<F>> offload(offload_pool& pool, F&& f) {
+    return {pool, std::forward<F>(f)};
+}
+
+template <typename F>
+[[nodiscard]] offload_awaitable<std::decay_t<F>> offload(F&& f) {
+    return {offload_pool::default_pool(), std::forward<F>(f)};
+}
+
+} // namespace xeq
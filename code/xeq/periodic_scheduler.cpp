@@ -0,0 +1,198 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "periodic_scheduler.hpp"
+#include "timer.hpp"
+
+#include <itlib/shared_from.hpp>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace xeq {
+
+namespace {
+
+class periodic_scheduler_impl final : public periodic_scheduler, public itlib::enable_shared_from {
+public:
+    explicit periodic_scheduler_impl(const executor_ptr& ex)
+        : m_timer(timer::create(ex))
+        , m_origin(clock_type::now())
+    {}
+
+    virtual job_id add(duration period, job_func func, missed_ticks policy) override {
+        if (period <= duration::zero()) throw std::runtime_error("xeq::periodic_scheduler: period must be positive");
+
+        auto j = std::make_shared<job>();
+        j->func = std::move(func);
+        j->policy = policy;
+
+        std::lock_guard l(m_mutex);
+        j->id = ++m_last_id;
+        auto& g = m_groups[period];
+        if (g.jobs.empty()) {
+            g.next = first_tick_after(clock_type::now(), period);
+        }
+        g.jobs.push_back(j);
+        m_periods.emplace(j->id, period);
+        arm();
+        return j->id;
+    }
+
+    virtual bool remove(job_id id) override {
+        std::lock_guard l(m_mutex);
+        auto p = m_periods.find(id);
+        if (p == m_periods.end()) return false;
+
+        auto g = m_groups.find(p->second);
+        auto& jobs = g->second.jobs;
+        for (auto i = jobs.begin(); i != jobs.end(); ++i) {
+            if ((*i)->id == id) {
+                (*i)->removed = true;
+                jobs.erase(i);
+                break;
+            }
+        }
+        if (jobs.empty()) {
+            // the timer may stay armed for it, which only costs an empty wake-up
+            m_groups.erase(g);
+        }
+        m_periods.erase(p);
+        return true;
+    }
+
+    virtual void clear() override {
+        std::lock_guard l(m_mutex);
+        for (auto& [_, g] : m_groups) {
+            for (auto& j : g.jobs) {
+                j->removed = true;
+            }
+        }
+        m_groups.clear();
+        m_periods.clear();
+        arm();
+    }
+
+    virtual size_t num_jobs() const override {
+        std::lock_guard l(m_mutex);
+        return m_periods.size();
+    }
+
+    virtual stats get_stats() const override {
+        std::lock_guard l(m_mutex);
+        return m_stats;
+    }
+
+private:
+    struct job {
+        job_id id = 0;
+        job_func func;
+        missed_ticks policy = missed_ticks::skip;
+        std::atomic_bool removed = false;
+    };
+    using job_ptr = std::shared_ptr<job>;
+
+    // jobs with the same period share ticks
+    struct group {
+        time_point next;
+        std::vector<job_ptr> jobs;
+    };
+
+    time_point first_tick_after(time_point t, duration period) const {
+        return m_origin + ((t - m_origin) / period + 1) * period;
+    }
+
+    void arm() {
+        auto earliest = time_point::max();
+        for (auto& [_, g] : m_groups) {
+            if (g.next < earliest) earliest = g.next;
+        }
+
+        if (earliest == m_armed_at) return;
+        m_armed_at = earliest;
+
+        if (earliest == time_point::max()) {
+            m_timer->cancel();
+            return;
+        }
+
+        // changing the expiry cancels the previous wait
+        m_timer->expire_at(earliest);
+        m_timer->add_wait_cb([weak_self = weak_from(this)](const error_code& ec) {
+            if (ec) return; // rearmed or destroyed
+            if (auto self = weak_self.lock()) {
+                self->wake();
+            }
+        });
+    }
+
+    void wake() {
+        struct run {
+            job_ptr j;
+            time_point tick;
+        };
+        std::vector<run> runs;
+
+        {
+            std::lock_guard l(m_mutex);
+            m_armed_at = time_point::max();
+            ++m_stats.wakeups;
+
+            const auto now = clock_type::now();
+            for (auto& [period, g] : m_groups) {
+                if (g.next > now) continue;
+
+                const int64_t due = (now - g.next) / period + 1;
+                for (auto& j : g.jobs) {
+                    if (j->policy == missed_ticks::skip) {
+                        runs.push_back({j, g.next + (due - 1) * period});
+                        m_stats.skipped += uint64_t(due - 1);
+                    }
+                    else {
+                        for (int64_t i = 0; i < due; ++i) {
+                            runs.push_back({j, g.next + i * period});
+                        }
+                    }
+                }
+                g.next += due * period;
+            }
+
+            arm();
+        }
+
+        uint64_t num_runs = 0;
+        for (auto& r : runs) {
+            if (r.j->removed) continue;
+            r.j->func(r.tick);
+            ++num_runs;
+        }
+
+        std::lock_guard l(m_mutex);
+        m_stats.runs += num_runs;
+    }
+
+    mutable std::mutex m_mutex;
+    timer_ptr m_timer;
+    const time_point m_origin;
+    time_point m_armed_at = time_point::max();
+
+    std::map<duration, group> m_groups;
+    std::unordered_map<job_id, duration> m_periods;
+    job_id m_last_id = 0;
+
+    stats m_stats = {};
+};
+
+} // namespace
+
+periodic_scheduler::~periodic_scheduler() = default; // export vtable
+
+periodic_scheduler_ptr periodic_scheduler::create(const executor_ptr& ex) {
+    return std::make_shared<periodic_scheduler_impl>(ex);
+}
+
+} // namespace xeq
@@ -0,0 +1,78 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "api.h"
+#include "executor.hpp"
+#include "ufunc.hpp"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace xeq {
+
+// recurring jobs (heartbeats, metric flushes, cache sweeps...) on a single timer
+//
+// ticks are computed from absolute time points: tick k of a job with period p is origin + k*p,
+// where the origin is the creation time of the scheduler. Thus the jobs don't drift and jobs which have the same
+// period (or whose periods are multiples of each other) tick together and share a wake-up
+//
+// a tick is missed when the scheduler wakes up later than the next one (a busy executor or a slow job)
+// * skip: the job runs once with the latest due tick and the others are counted as skipped
+// * catch_up: the job runs once for every due tick, back to back
+//
+// jobs run on the executor given to create. Use a strand to serialize them
+// the scheduler is thread safe. Destroying it cancels all jobs
+
+class periodic_scheduler;
+using periodic_scheduler_ptr = std::shared_ptr<periodic_scheduler>;
+
+class XEQ_API periodic_scheduler {
+public:
+    using clock_type = std::chrono::steady_clock;
+    using duration = clock_type::duration;
+    using time_point = clock_type::time_point;
+
+    enum class missed_ticks {
+        skip,
+        catch_up,
+    };
+
+    // called with the tick it runs for
+    using job_func = ufunc<void(time_point tick)>;
+
+    using job_id = uint64_t;
+
+    struct stats {
+        uint64_t wakeups;
+        uint64_t runs;
+        uint64_t skipped;
+    };
+
+    virtual ~periodic_scheduler();
+
+    periodic_scheduler(const periodic_scheduler&) = delete;
+    periodic_scheduler& operator=(const periodic_scheduler&) = delete;
+
+    static periodic_scheduler_ptr create(const executor_ptr& ex);
+
+    // the first run is on the first tick after now
+    // throws if the period is not positive
+    virtual job_id add(duration period, job_func job, missed_ticks policy = missed_ticks::skip) = 0;
+
+    // the job won't run after this returns, unless it's running right now
+    // returns false if there is no such job
+    virtual bool remove(job_id id) = 0;
+
+    // remove all jobs
+    virtual void clear() = 0;
+
+    virtual size_t num_jobs() const = 0;
+
+    virtual stats get_stats() const = 0;
+
+protected:
+    periodic_scheduler() = default;
+};
+
+} // namespace xeq
@@ -0,0 +1,152 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "priority_scheduler.hpp"
+#include "context.hpp"
+#include "impl/queued_executor.hpp"
+
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <stdexcept>
+#include <cassert>
+
+namespace asio = boost::asio;
+
+namespace xeq {
+
+namespace {
+
+class level_queues : public itlib::enable_shared_from {
+public:
+    using key_type = int;
+
+    asio::io_context::executor_type m_aexec;
+
+    level_queues(asio::io_context::executor_type aexec, const priority_scheduler::config& cfg)
+        : m_aexec(std::move(aexec))
+        , m_num_levels(cfg.num_levels)
+        , m_starvation_budget(cfg.starvation_budget)
+    {}
+
+    void push(int level, ufunc<void()> func) {
+        {
+            std::lock_guard l(m_mutex);
+            m_levels[level].queue.push_back(std::move(func));
+        }
+        // one token per handler, so that every token has something to execute
+        asio::post(m_aexec, with_handler_allocator{[self = shared_from(this)] {
+            self->run_one();
+        }});
+    }
+
+    priority_scheduler::stats get_stats() {
+        priority_scheduler::stats ret = {};
+        std::lock_guard l(m_mutex);
+        for (int i = 0; i < m_num_levels; ++i) {
+            auto& lvl = m_levels[i];
+            ret.executed[i] = lvl.executed;
+            ret.starvation_rescues[i] = lvl.rescues;
+            ret.queued[i] = lvl.queue.size();
+        }
+        return ret;
+    }
+
+private:
+    struct level {
+        std::deque<ufunc<void()>> queue;
+        uint32_t bypassed = 0;
+        uint64_t executed = 0;
+        uint64_t rescues = 0;
+    };
+
+    std::mutex m_mutex;
+    level m_levels[priority_scheduler::max_levels];
+    const int m_num_levels;
+    const uint32_t m_starvation_budget;
+
+    // call with m_mutex locked
+    int pick() {
+        int top = 0;
+        while (top < m_num_levels && m_levels[top].queue.empty()) ++top;
+        if (top == m_num_levels) return -1;
+
+        int served = top;
+
+        // the lowest level which has exhausted its budget goes first
+        for (int i = m_num_levels - 1; i > top; --i) {
+            auto& lvl = m_levels[i];
+            if (!lvl.queue.empty() && lvl.bypassed >= m_starvation_budget) {
+                served = i;
+                ++lvl.rescues;
+                break;
+            }
+        }
+
+        for (int i = served + 1; i < m_num_levels; ++i) {
+            auto& lvl = m_levels[i];
+            if (!lvl.queue.empty()) ++lvl.bypassed;
+        }
+        m_levels[served].bypassed = 0;
+        return served;
+    }
+
+    void run_one() {
+        ufunc<void()> func;
+        {
+            std::lock_guard l(m_mutex);
+            auto i = pick();
+            assert(i >= 0); // tokens match handlers one to one
+            if (i < 0) return; // rescue
+            auto& lvl = m_levels[i];
+            func = std::move(lvl.queue.front());
+            lvl.queue.pop_front();
+            ++lvl.executed;
+        }
+        func();
+    }
+};
+
+class priority_scheduler_impl final : public priority_scheduler {
+public:
+    std::shared_ptr<level_queues> m_queues;
+    std::vector<executor_ptr> m_executors;
+
+    priority_scheduler_impl(context& ctx, const config& cfg)
+        : m_queues(std::make_shared<level_queues>(ctx.as_asio_io_context().get_executor(), cfg))
+    {
+        m_executors.reserve(cfg.num_levels);
+        for (int i = 0; i < cfg.num_levels; ++i) {
+            m_executors.push_back(std::make_shared<impl::queued_executor<level_queues>>(m_queues, i));
+        }
+    }
+
+    virtual int num_levels() const noexcept override {
+        return int(m_executors.size());
+    }
+
+    virtual const executor_ptr& get_executor(int priority) const noexcept override {
+        assert(priority >= 0 && priority < num_levels());
+        // rescue: clamp to a valid level
+        if (priority < 0) priority = 0;
+        if (priority >= num_levels()) priority = num_levels() - 1;
+        return m_executors[priority];
+    }
+
+    virtual stats get_stats() const override {
+        return m_queues->get_stats();
+    }
+};
+
+} // namespace
+
+priority_scheduler::~priority_scheduler() = default; // export vtable
+
+priority_scheduler_ptr priority_scheduler::create(context& ctx, config cfg) {
+    if (cfg.num_levels < 1 || cfg.num_levels > max_levels) {
+        throw std::runtime_error("xeq::priority_scheduler: invalid number of levels");
+    }
+    return std::make_shared<priority_scheduler_impl>(ctx, cfg);
+}
+
+} // namespace xeq
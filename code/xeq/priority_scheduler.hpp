@@ -0,0 +1,72 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "api.h"
+#include "executor.hpp"
+#include "ufunc.hpp"
+#include <cstdint>
+#include <memory>
+
+namespace xeq {
+
+class context;
+
+// executors which share a context, but schedule handlers by priority
+// level 0 is the highest priority, num_levels - 1 is the lowest
+//
+// every post goes to a per-level queue and a generic token is posted to the context
+// whichever thread picks a token executes the highest priority handler which is queued at that time
+// thus a burst of low priority work can't delay high priority work
+//
+// to prevent starvation, a non-empty lower level which has been bypassed starvation_budget times in a row
+// is served next regardless of the higher levels
+//
+// the executors are regular xeq executors: they can be used with co_spawn, strands, timers and wobjs
+// coroutines spawned on a level stay on it, as do timer completions for timers created on it
+
+class priority_scheduler;
+using priority_scheduler_ptr = std::shared_ptr<priority_scheduler>;
+
+class XEQ_API priority_scheduler {
+public:
+    static constexpr int max_levels = 8;
+
+    struct config {
+        int num_levels = 3;
+        uint32_t starvation_budget = 32;
+    };
+
+    struct stats {
+        uint64_t executed[max_levels];
+        uint64_t starvation_rescues[max_levels]; // times a level was served only because of its budget
+        size_t queued[max_levels];
+    };
+
+    virtual ~priority_scheduler();
+
+    priority_scheduler(const priority_scheduler&) = delete;
+    priority_scheduler& operator=(const priority_scheduler&) = delete;
+
+    static priority_scheduler_ptr create(context& ctx, config cfg);
+    static priority_scheduler_ptr create(context& ctx) { return create(ctx, config{}); }
+
+    virtual int num_levels() const noexcept = 0;
+
+    virtual const executor_ptr& get_executor(int priority) const noexcept = 0;
+
+    [[nodiscard]] strand_ptr make_strand(int priority) {
+        return get_executor(priority)->make_strand();
+    }
+
+    void post(int priority, ufunc<void()> func) {
+        get_executor(priority)->post(std::move(func));
+    }
+
+    virtual stats get_stats() const = 0;
+
+protected:
+    priority_scheduler() = default;
+};
+
+} // namespace xeq
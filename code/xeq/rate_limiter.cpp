@@ -0,0 +1,183 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "rate_limiter.hpp"
+#include "timer.hpp"
+
+#include <itlib/shared_from.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
+
+namespace xeq {
+
+namespace {
+
+class rate_limiter_impl final : public rate_limiter, public itlib::enable_shared_from {
+public:
+    rate_limiter_impl(const executor_ptr& ex, const config& cfg)
+        : m_executor(ex)
+        , m_rate(cfg.rate)
+        , m_burst(cfg.burst)
+        , m_tokens(cfg.burst)
+        , m_last(clock_type::now())
+    {}
+
+    virtual bool try_acquire(double n) override {
+        check_tokens(n);
+        std::lock_guard l(m_mutex);
+        return take(n, clock_type::now());
+    }
+
+    virtual double available() override {
+        std::lock_guard l(m_mutex);
+        refill(clock_type::now());
+        return m_tokens;
+    }
+
+    virtual size_t num_waiters() const override {
+        std::lock_guard l(m_mutex);
+        return m_num_waiters;
+    }
+
+    virtual bool enqueue(waiter& w) override {
+        std::lock_guard l(m_mutex);
+        const auto now = clock_type::now();
+        if (take(w.n, now)) return false;
+
+        w.next = nullptr;
+        if (m_tail) {
+            m_tail->next = &w;
+        }
+        else {
+            m_head = &w;
+        }
+        m_tail = &w;
+        ++m_num_waiters;
+
+        if (!m_armed) {
+            arm(now);
+        }
+        return true;
+    }
+
+    virtual void check_acquire(double n) const override {
+        check_tokens(n);
+        if (n > m_burst) throw std::runtime_error("xeq::rate_limiter: can't acquire more than the burst");
+    }
+
+private:
+    static void check_tokens(double n) {
+        // also catches nan, which would never compare as available
+        if (!std::isfinite(n) || n <= 0) throw std::runtime_error("xeq::rate_limiter: tokens must be positive and finite");
+    }
+
+    void refill(clock_type::time_point now) {
+        if (now <= m_last) return;
+        const auto elapsed = std::chrono::duration<double>(now - m_last).count();
+        m_tokens = std::min(m_burst, m_tokens + elapsed * m_rate);
+        m_last = now;
+    }
+
+    // only if there are no waiters, so as not to overtake them
+    bool take(double n, clock_type::time_point now) {
+        if (m_head) return false;
+        refill(now);
+        if (m_tokens < n) return false;
+        m_tokens -= n;
+        return true;
+    }
+
+    // the timer is armed for the time when the head of the queue can be satisfied
+    // the waiters behind it can't be satisfied sooner, so it's not rearmed when they are added
+    void arm(clock_type::time_point now) {
+        if (!m_timer) {
+            m_timer = timer::create(m_executor);
+        }
+        const auto missing = std::max(m_head->n - m_tokens, 0.0);
+        const auto wait = std::chrono::ceil<clock_type::duration>(std::chrono::duration<double>(missing / m_rate));
+        m_armed = true;
+        m_timer->expire_at(now + wait);
+        // the limiter must outlive the pending wait, so the callback holds it
+        // if the wait is abandoned (the context is destroyed with it pending), the callback is destroyed with it
+        // and so is the limiter, if nobody else holds it
+        m_timer->add_wait_cb([self = shared_from(this)](const error_code&) {
+            self->serve();
+        });
+    }
+
+    void serve() {
+        timer_ptr idle_timer;
+        std::unique_lock l(m_mutex);
+        m_armed = false;
+
+        const auto now = clock_type::now();
+        refill(now);
+
+        waiter* ready = nullptr;
+        waiter* ready_tail = nullptr;
+        while (m_head && m_tokens >= m_head->n) {
+            auto w = m_head;
+            m_tokens -= w->n;
+            m_head = w->next;
+            --m_num_waiters;
+
+            w->next = nullptr;
+            if (ready_tail) {
+                ready_tail->next = w;
+            }
+            else {
+                ready = w;
+            }
+            ready_tail = w;
+        }
+        if (!m_head) {
+            m_tail = nullptr;
+            // release the timer while there are no waiters
+            // it is destroyed outside of the lock as that goes into asio
+            idle_timer = std::move(m_timer);
+        }
+        else {
+            arm(now);
+        }
+        l.unlock();
+        idle_timer.reset();
+
+        // resuming a waiter may destroy it, so read next first
+        while (ready) {
+            auto w = ready;
+            ready = w->next;
+            auto ex = std::move(w->executor);
+            ex->post_resume(w->handle);
+        }
+    }
+
+    const executor_ptr m_executor;
+    const double m_rate;
+    const double m_burst;
+
+    mutable std::mutex m_mutex;
+    double m_tokens;
+    clock_type::time_point m_last;
+
+    waiter* m_head = nullptr;
+    waiter* m_tail = nullptr;
+    size_t m_num_waiters = 0;
+
+    timer_ptr m_timer; // only while there are waiters
+    bool m_armed = false;
+};
+
+} // namespace
+
+rate_limiter::~rate_limiter() = default; // export vtable
+
+rate_limiter_ptr rate_limiter::create(const executor_ptr& ex, config cfg) {
+    if (cfg.rate <= 0) throw std::runtime_error("xeq::rate_limiter: rate must be positive");
+    if (cfg.burst <= 0) throw std::runtime_error("xeq::rate_limiter: burst must be positive");
+    return std::make_shared<rate_limiter_impl>(ex, cfg);
+}
+
+} // namespace xeq
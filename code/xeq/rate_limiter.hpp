@@ -0,0 +1,102 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "api.h"
+#include "executor.hpp"
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <memory>
+
+namespace xeq {
+
+// token bucket
+//
+// co_await limiter->acquire(n); suspends until n tokens are available and takes them
+//
+// the bucket is refilled lazily from a monotonic clock when it's accessed, so an idle limiter costs nothing
+// but its memory. Waiters are served in FIFO order: a small request doesn't overtake a larger one which came first
+// a limiter creates a timer when it has to wait and releases it once the waiters have been served,
+// so many limiters (say one per tenant) don't mean as many live timers
+//
+// the limiter is thread safe. Waiters are resumed on their own executors
+// the timer runs on the executor given to create
+
+class rate_limiter;
+using rate_limiter_ptr = std::shared_ptr<rate_limiter>;
+
+class XEQ_API rate_limiter {
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    struct config {
+        double rate = 1; // tokens per second
+        double burst = 1; // capacity of the bucket, which starts full
+    };
+
+    virtual ~rate_limiter();
+
+    rate_limiter(const rate_limiter&) = delete;
+    rate_limiter& operator=(const rate_limiter&) = delete;
+
+    // throws if the rate or burst are not positive
+    static rate_limiter_ptr create(const executor_ptr& ex, config cfg);
+
+    // take n tokens if there are enough of them and nobody is waiting
+    // throws if n is not positive and finite
+    virtual bool try_acquire(double n = 1) = 0;
+
+    // tokens available right now (refills)
+    virtual double available() = 0;
+
+    virtual size_t num_waiters() const = 0;
+
+    // intrusive queue node, lives in the awaitable
+    struct waiter {
+        double n = 0;
+        std::coroutine_handle<> handle = {};
+        executor_ptr executor = {};
+        waiter* next = nullptr;
+    };
+
+    class acquire_awaitable {
+    public:
+        acquire_awaitable(rate_limiter& limiter, double n)
+            : m_limiter(limiter)
+            , m_waiter{n}
+        {}
+
+        bool await_ready() { return m_limiter.try_acquire(m_waiter.n); }
+
+        template <typename PromiseType>
+        bool await_suspend(std::coroutine_handle<PromiseType> h) {
+            m_waiter.handle = h;
+            m_waiter.executor = h.promise().m_executor;
+            return m_limiter.enqueue(m_waiter);
+        }
+
+        void await_resume() noexcept {}
+
+    private:
+        rate_limiter& m_limiter;
+        waiter m_waiter;
+    };
+
+    // throws if n is not positive and finite or if it's more than the burst as it would never be satisfied
+    [[nodiscard]] acquire_awaitable acquire(double n = 1) {
+        check_acquire(n);
+        return {*this, n};
+    }
+
+protected:
+    rate_limiter() = default;
+
+    // adds the waiter to the queue
+    // returns false if the tokens were acquired without waiting (the waiter is not queued then)
+    virtual bool enqueue(waiter& w) = 0;
+
+    virtual void check_acquire(double n) const = 0;
+};
+
+} // namespace xeq
@@ -0,0 +1,400 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "sim_context.hpp"
+#include "executor.hpp"
+#include "trace.hpp"
+#include "executor_bounds.hpp"
+
+#include <boost/asio/execution_context.hpp>
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/execution.hpp>
+
+#include <itlib/shared_from.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace asio = boost::asio;
+
+namespace xeq {
+
+namespace {
+// the handlers of a strand, which are run in order
+struct lane {
+    std::deque<ufunc<void()>> tasks;
+};
+using lane_ptr = std::shared_ptr<lane>;
+}
+
+struct sim_timer;
+
+struct sim_context::impl : public asio::execution_context {
+    // an entry is either a single handler or a strand which has handlers
+    struct runnable {
+        ufunc<void()> func;
+        lane_ptr strand;
+    };
+
+    explicit impl(uint64_t seed)
+        : m_seed(seed)
+        , m_rng(seed)
+    {}
+
+    ~impl() {
+        // destroy what's left before the services
+        m_ready.clear();
+        shutdown();
+        destroy();
+    }
+
+    const uint64_t m_seed;
+    std::mt19937_64 m_rng; // the engine's output is specified by the standard, unlike the distributions
+    time_point m_now = {};
+    std::thread::id m_thread; // the thread in run
+
+    std::vector<runnable> m_ready;
+
+    using timer_queue = std::multimap<time_point, sim_timer*>;
+    timer_queue m_timers;
+
+    executor_ptr m_executor;
+
+    void push(const lane_ptr& l, ufunc<void()> func) {
+        if (!l) {
+            m_ready.push_back({std::move(func), {}});
+            return;
+        }
+        const bool idle = l->tasks.empty();
+        l->tasks.push_back(std::move(func));
+        if (idle) {
+            m_ready.push_back({{}, l});
+        }
+    }
+
+    void run_one() {
+        std::swap(m_ready[size_t(m_rng() % m_ready.size())], m_ready.back());
+        auto r = std::move(m_ready.back());
+        m_ready.pop_back();
+        if (r.strand) {
+            r.func = std::move(r.strand->tasks.front());
+            r.strand->tasks.pop_front();
+            if (!r.strand->tasks.empty()) {
+                m_ready.push_back({{}, std::move(r.strand)});
+            }
+        }
+        r.func();
+    }
+
+    void fire_due();
+
+    size_t run_until(time_point limit) {
+        struct thread_guard {
+            std::thread::id& id;
+            std::thread::id prev;
+            explicit thread_guard(std::thread::id& i) : id(i), prev(std::exchange(i, std::this_thread::get_id())) {}
+            ~thread_guard() { id = prev; }
+        } guard(m_thread);
+
+        size_t n = 0;
+        while (true) {
+            while (!m_ready.empty()) {
+                run_one();
+                ++n;
+            }
+            if (m_timers.empty() || m_timers.begin()->first > limit) break;
+            m_now = std::max(m_now, m_timers.begin()->first);
+            fire_due();
+        }
+
+        if (limit != time_point::max()) {
+            m_now = std::max(m_now, limit);
+        }
+        return n;
+    }
+};
+
+namespace {
+
+// a standard asio executor which posts to the simulation
+class sim_asio_executor {
+public:
+    sim_asio_executor(sim_context::impl& ctx, lane_ptr l)
+        : m_ctx(&ctx)
+        , m_lane(std::move(l))
+    {}
+
+    template <typename F>
+    void execute(F&& f) const {
+        m_ctx->push(m_lane, std::forward<F>(f));
+    }
+
+    asio::execution_context& query(asio::execution::context_t) const noexcept {
+        return *m_ctx;
+    }
+
+    static constexpr asio::execution::blocking_t query(asio::execution::blocking_t) noexcept {
+        return asio::execution::blocking.never;
+    }
+
+    sim_asio_executor require(asio::execution::blocking_t::never_t) const {
+        return *this;
+    }
+
+    friend bool operator==(const sim_asio_executor& a, const sim_asio_executor& b) noexcept {
+        return a.m_ctx == b.m_ctx && a.m_lane == b.m_lane;
+    }
+    friend bool operator!=(const sim_asio_executor& a, const sim_asio_executor& b) noexcept {
+        return !(a == b);
+    }
+
+private:
+    sim_context::impl* m_ctx;
+    lane_ptr m_lane;
+};
+
+// common for the context executor and strands: the lane is null for the former
+template <typename Base>
+class sim_executor_base : public Base {
+public:
+    sim_context::impl& m_ctx;
+    lane_ptr m_lane;
+
+    sim_executor_base(sim_context::impl& ctx, lane_ptr l)
+        : m_ctx(ctx)
+        , m_lane(std::move(l))
+    {}
+
+    virtual void post(ufunc<void()> func) override {
+        if (trace::enabled()) [[unlikely]] {
+            func = trace::traced_post(this, std::move(func));
+        }
+        if (auto& b = this->get_bounds()) [[unlikely]] {
+            func = b->track(std::move(func));
+        }
+        m_ctx.push(m_lane, std::move(func));
+    }
+
+    virtual void post_resume(std::coroutine_handle<> handle) override {
+        post([=] { handle.resume(); });
+    }
+
+    virtual executor_ptr get_super_executor() noexcept override {
+        return m_ctx.m_executor;
+    }
+
+    boost::asio::any_io_executor as_asio_executor() noexcept override {
+        return sim_asio_executor(m_ctx, m_lane);
+    }
+
+    virtual bool running_in_this_thread() const noexcept override {
+        return m_ctx.m_thread == std::this_thread::get_id();
+    }
+};
+
+class sim_executor final : public sim_executor_base<executor>, public itlib::enable_shared_from {
+public:
+    explicit sim_executor(sim_context::impl& ctx)
+        : sim_executor_base(ctx, {})
+    {}
+
+    virtual bool is_strand() const noexcept override { return false; }
+
+    virtual strand_ptr make_strand() override;
+
+protected:
+    virtual timer_ptr make_timer() override;
+};
+
+class sim_strand final : public sim_executor_base<strand>, public itlib::enable_shared_from {
+public:
+    explicit sim_strand(sim_context::impl& ctx)
+        : sim_executor_base(ctx, std::make_shared<lane>())
+    {}
+
+    virtual strand_ptr make_strand() override {
+        return shared_from(this);
+    }
+
+protected:
+    virtual timer_ptr make_timer() override;
+};
+
+strand_ptr sim_executor::make_strand() {
+    return std::make_shared<sim_strand>(m_ctx);
+}
+
+} // namespace
+
+// mirrors the asio timer: changing the expiry or destroying the timer cancels the pending waits
+// and waiting on an expired timer completes right away
+struct sim_timer final : public timer {
+    sim_context::impl& m_ctx;
+    time_point m_expiry = {};
+
+    struct waiter {
+        wait_func cb;
+        wait_node* node;
+    };
+    std::vector<waiter> m_waiters;
+
+    sim_context::impl::timer_queue::iterator m_slot;
+    bool m_scheduled = false;
+
+    sim_timer(const executor_ptr& ex, sim_context::impl& ctx)
+        : timer(ex)
+        , m_ctx(ctx)
+    {}
+
+    ~sim_timer() {
+        cancel();
+    }
+
+    virtual size_t expire_after(duration t_from_now) override {
+        if (t_from_now >= time_point::max() - m_ctx.m_now) {
+            return expire_never();
+        }
+        return expire_at(m_ctx.m_now + t_from_now);
+    }
+    virtual size_t expire_at(time_point t) override {
+        const auto n = cancel();
+        m_expiry = t;
+        return n;
+    }
+    virtual size_t expire_never() override {
+        return expire_at(time_point::max());
+    }
+
+    virtual size_t cancel() override {
+        unschedule();
+        auto waiters = std::move(m_waiters);
+        m_waiters.clear();
+        for (auto& w : waiters) {
+            complete(w, std::make_error_code(std::errc::operation_canceled));
+        }
+        return waiters.size();
+    }
+    virtual size_t cancel_one() override {
+        if (m_waiters.empty()) return 0;
+        auto w = std::move(m_waiters.front());
+        m_waiters.erase(m_waiters.begin());
+        if (m_waiters.empty()) {
+            unschedule();
+        }
+        complete(w, std::make_error_code(std::errc::operation_canceled));
+        return 1;
+    }
+
+    virtual time_point expiry() const override {
+        return m_expiry;
+    }
+
+    virtual void add_wait_cb(wait_func cb) override {
+        add({std::move(cb), nullptr});
+    }
+
+    virtual void add_wait_node(wait_node& node) override {
+        add({{}, &node});
+    }
+
+    void add(waiter w) {
+        if (m_expiry <= m_ctx.m_now) {
+            complete(w, {});
+            return;
+        }
+        m_waiters.push_back(std::move(w));
+        if (!m_scheduled && m_expiry != time_point::max()) {
+            m_slot = m_ctx.m_timers.emplace(m_expiry, this);
+            m_scheduled = true;
+        }
+    }
+
+    void unschedule() {
+        if (!m_scheduled) return;
+        m_ctx.m_timers.erase(m_slot);
+        m_scheduled = false;
+    }
+
+    // called by the context, which has removed us from the queue
+    void fire() {
+        m_scheduled = false;
+        auto waiters = std::move(m_waiters);
+        m_waiters.clear();
+        for (auto& w : waiters) {
+            complete(w, {});
+        }
+    }
+
+    static void complete_node(void* n) {
+        auto& node = *static_cast<wait_node*>(n);
+        node.complete(node, node.result);
+    }
+
+    void complete(waiter& w, const error_code& ec) {
+        if (w.node) {
+            w.node->result = ec;
+            m_executor->post_call(complete_node, w.node);
+        }
+        else {
+            m_executor->post([cb = std::move(w.cb), ec]() mutable {
+                cb(ec);
+            });
+        }
+    }
+};
+
+void sim_context::impl::fire_due() {
+    while (!m_timers.empty() && m_timers.begin()->first <= m_now) {
+        auto t = m_timers.begin()->second;
+        m_timers.erase(m_timers.begin());
+        t->fire();
+    }
+}
+
+namespace {
+timer_ptr sim_executor::make_timer() {
+    return std::make_unique<sim_timer>(shared_from(this), m_ctx);
+}
+timer_ptr sim_strand::make_timer() {
+    return std::make_unique<sim_timer>(shared_from(this), m_ctx);
+}
+}
+
+sim_context::sim_context(uint64_t seed)
+    : m_impl(std::make_unique<impl>(seed))
+{
+    m_impl->m_executor = std::make_shared<sim_executor>(*m_impl);
+}
+
+sim_context::~sim_context() = default;
+
+sim_context::time_point sim_context::now() const noexcept {
+    return m_impl->m_now;
+}
+
+uint64_t sim_context::seed() const noexcept {
+    return m_impl->m_seed;
+}
+
+size_t sim_context::run() {
+    return m_impl->run_until(time_point::max());
+}
+
+size_t sim_context::run_until(time_point t) {
+    return m_impl->run_until(t);
+}
+
+const executor_ptr& sim_context::get_executor() const noexcept {
+    return m_impl->m_executor;
+}
+
+strand_ptr sim_context::make_strand() {
+    return m_impl->m_executor->make_strand();
+}
+
+} // namespace xeq
@@ -0,0 +1,68 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "api.h"
+#include "executor_ptr.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <memory>
+
+namespace xeq {
+
+// a deterministic simulated context on a virtual clock
+//
+// sim_context sim(seed);
+// co_spawn(sim.make_strand(), session_with_a_10_minute_timeout());
+// sim.run(); // returns in milliseconds with sim.now() 10 minutes later
+//
+// its executors and the timers created with them (timer::create, timer_wobj...) are driven by run:
+// * ready handlers are run in an order picked by a random generator with the given seed,
+//   so the same seed always gives the same interleaving and different seeds explore others
+// * strands keep their handlers in FIFO order, but they are interleaved with everything else
+// * when there are no ready handlers, the clock jumps straight to the next timer expiry
+//
+// it's single-threaded: post, timers and run must all be used from the same thread
+// there is no io: asio objects must not be created on its asio executors
+// components which read std::chrono::steady_clock directly (rate_limiter, periodic_scheduler) are not simulated
+// the context must outlive its executors' timers
+
+class XEQ_API sim_context {
+public:
+    using clock_type = timer::clock_type;
+    using duration = timer::duration;
+    using time_point = timer::time_point;
+
+    explicit sim_context(uint64_t seed = 0);
+    ~sim_context();
+
+    sim_context(const sim_context&) = delete;
+    sim_context& operator=(const sim_context&) = delete;
+
+    // the virtual clock starts at the epoch of clock_type
+    time_point now() const noexcept;
+
+    uint64_t seed() const noexcept;
+
+    // run until there are no ready handlers and no pending timer waits
+    // returns the number of handlers run
+    size_t run();
+
+    // as run, but don't advance the clock past t
+    // the clock is at t on return, unless the handlers ran out before it
+    size_t run_until(time_point t);
+    size_t run_for(duration d) { return run_until(now() + d); }
+
+    // run the ready handlers and the timers which have expired, but don't advance the clock
+    size_t poll() { return run_until(now()); }
+
+    const executor_ptr& get_executor() const noexcept;
+
+    [[nodiscard]] strand_ptr make_strand();
+
+    struct impl;
+private:
+    std::unique_ptr<impl> m_impl;
+};
+
+} // namespace xeq
@@ -5,44 +5,83 @@
 #include "executor.hpp"
 #include "wait_func.hpp"
 #include "wait_func_invoke.hpp"
+#include "wait_node.hpp"
 #include "coro_wobj.hpp"
+#include <cassert>
+#include <utility>
 
 namespace xeq {
 
-class simple_wobj {
-    executor_ptr m_executor;
+// the executor is an executor_ptr or a typed executor (see typed_executor.hpp)
+template <typename Executor>
+class basic_simple_wobj {
+    Executor m_executor;
+    // at most one of these is set
     wait_func m_cb;
+    wait_node* m_node = nullptr;
 public:
-    explicit simple_wobj(const executor_ptr& s) : m_executor(s) {}
+    explicit basic_simple_wobj(const Executor& s) : m_executor(s) {}
 
     void notify_one() {
-        m_executor->post([this] {
-            if (m_cb) {
-                auto cb = std::exchange(m_cb, nullptr);
-                wait_func_invoke_cancelled(cb);
-            }
-        });
+        impl::executor_of(m_executor).post_call(do_notify_one, this);
     }
 
     void wait(wait_func cb) {
-        assert(m_executor->running_in_this_thread());
-        if (m_cb) {
-            m_executor->post([old = std::move(m_cb)] {
-                wait_func_invoke_cancelled(old);
-            });
-        }
+        assert(impl::executor_of(m_executor).running_in_this_thread());
+        cancel_waiter();
         m_cb = std::move(cb);
     }
 
+    void wait(wait_node& node) {
+        assert(impl::executor_of(m_executor).running_in_this_thread());
+        cancel_waiter();
+        m_node = &node;
+    }
+
     using executor_type = executor;
-    const executor_ptr& get_executor() noexcept {
-        return m_executor;
+    decltype(auto) get_executor() noexcept {
+        return impl::erased_executor(m_executor);
     }
 
     // corouitne interface implemented in coro_wobj.hpp
-    [[nodiscard]] wait_awaitable<simple_wobj> wait() {
+    [[nodiscard]] wait_awaitable<basic_simple_wobj> wait() {
         return wait_awaitable(*this);
     }
+
+private:
+    static void do_notify_one(void* self) {
+        auto& w = *static_cast<basic_simple_wobj*>(self);
+        if (w.m_cb) {
+            auto cb = std::exchange(w.m_cb, nullptr);
+            wait_func_invoke_cancelled(cb);
+        }
+        else if (w.m_node) {
+            wait_node_complete_cancelled(*std::exchange(w.m_node, nullptr));
+        }
+    }
+
+    static void do_cancel_node(void* node) {
+        wait_node_complete_cancelled(*static_cast<wait_node*>(node));
+    }
+
+    // a new wait replaces the old one, which is completed as cancelled
+    void cancel_waiter() {
+        if (m_cb) {
+            impl::executor_of(m_executor).post([old = std::move(m_cb)] {
+                wait_func_invoke_cancelled(old);
+            });
+            m_cb = nullptr;
+        }
+        else if (m_node) {
+            impl::executor_of(m_executor).post_call(do_cancel_node, std::exchange(m_node, nullptr));
+        }
+    }
+};
+
+// a class rather than an alias, so that it can be forward declared
+class simple_wobj : public basic_simple_wobj<executor_ptr> {
+public:
+    using basic_simple_wobj::basic_simple_wobj;
 };
 
 } // namespace xeq
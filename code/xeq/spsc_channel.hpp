@@ -0,0 +1,200 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "executor.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <coroutine>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <vector>
+
+namespace xeq {
+
+// a lock-free channel for exactly one producer and one consumer strand
+//
+// spsc_channel<packet> ch(consumer_strand, 1024);
+// // producer (any single thread or strand):
+// if (!ch.try_push(std::move(p))) { /* full: drop or retry later */ }
+// // consumer (a coroutine on consumer_strand):
+// while (co_await ch.wait()) {
+//     while (auto p = ch.try_pop()) handle(*p);
+// }
+//
+// the head (written by the producer) and the tail (written by the consumer) are on separate cache lines
+// and each side caches the other's index, so it only touches the other's line when the ring looks full or empty
+// try_push_n and try_pop_n move a batch with a single index store
+// the consumer is woken through its strand, and only when it's parked in wait. Unlike simple_wobj, a producer
+// which publishes to an awake consumer doesn't post anything
+// a full ring is reported to the producer, which decides what to do
+//
+// the channel must outlive both sides. A consumer must not be parked when it's destroyed
+
+template <typename T>
+class spsc_channel {
+public:
+    // the capacity is rounded up to a power of two
+    spsc_channel(strand_ptr consumer, size_t capacity)
+        : m_consumer(std::move(consumer))
+        , m_slots(std::bit_ceil(capacity ? capacity : 1))
+        , m_mask(m_slots.size() - 1)
+    {}
+
+    spsc_channel(const spsc_channel&) = delete;
+    spsc_channel& operator=(const spsc_channel&) = delete;
+
+    size_t capacity() const noexcept { return m_slots.size(); }
+
+    const strand_ptr& get_consumer() const noexcept { return m_consumer; }
+
+    // producer side
+
+    template <typename U>
+    bool try_push(U&& v) {
+        const auto h = m_head.load(std::memory_order_relaxed);
+        if (h - m_tail_cache == capacity()) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            if (h - m_tail_cache == capacity()) return false;
+        }
+        m_slots[h & m_mask].emplace(std::forward<U>(v));
+        publish(h + 1);
+        return true;
+    }
+
+    // moves as many values as fit and returns the iterator to the first one which didn't
+    template <typename It>
+    It try_push_n(It begin, It end) {
+        const auto h = m_head.load(std::memory_order_relaxed);
+        size_t n = size_t(std::distance(begin, end));
+        if (h - m_tail_cache + n > capacity()) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            n = std::min(n, capacity() - (h - m_tail_cache));
+        }
+        if (!n) return begin;
+        for (size_t i = 0; i < n; ++i, ++begin) {
+            m_slots[(h + i) & m_mask].emplace(std::move(*begin));
+        }
+        publish(h + n);
+        return begin;
+    }
+
+    // no more values: a consumer wait returns false after the ring has been drained
+    void close() {
+        m_closed.store(true);
+        wake_consumer();
+    }
+
+    // consumer side
+
+    std::optional<T> try_pop() {
+        const auto t = m_tail.load(std::memory_order_relaxed);
+        if (t == m_head_cache) {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+            if (t == m_head_cache) return std::nullopt;
+        }
+        auto& slot = m_slots[t & m_mask];
+        std::optional<T> ret(std::move(slot));
+        slot.reset();
+        m_tail.store(t + 1, std::memory_order_release);
+        return ret;
+    }
+
+    // moves up to max values to out and returns how many
+    template <typename OutIt>
+    size_t try_pop_n(OutIt out, size_t max) {
+        const auto t = m_tail.load(std::memory_order_relaxed);
+        if (m_head_cache - t < max) {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+        }
+        const size_t n = std::min(max, m_head_cache - t);
+        for (size_t i = 0; i < n; ++i) {
+            auto& slot = m_slots[(t + i) & m_mask];
+            *out++ = std::move(*slot);
+            slot.reset();
+        }
+        if (n) {
+            m_tail.store(t + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    class wait_awaitable {
+    public:
+        explicit wait_awaitable(spsc_channel& ch) noexcept : m_ch(ch) {}
+
+        bool await_ready() const noexcept { return m_ch.ready(); }
+
+        bool await_suspend(std::coroutine_handle<> h) {
+            assert(m_ch.m_consumer->running_in_this_thread());
+            m_ch.m_parked_handle = h;
+            m_ch.m_parked.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_ch.ready() && m_ch.m_parked.exchange(false)) {
+                // the producer got here first (if it had unparked us, it would have posted the resume)
+                return false;
+            }
+            return true;
+        }
+
+        // false if the channel is closed and empty
+        bool await_resume() const noexcept { return !m_ch.empty(); }
+
+    private:
+        spsc_channel& m_ch;
+    };
+
+    // resumes (on the consumer strand) when there are values or the channel is closed
+    [[nodiscard]] wait_awaitable wait() noexcept {
+        return wait_awaitable(*this);
+    }
+
+private:
+    static constexpr size_t cache_line = 64;
+
+    const strand_ptr m_consumer;
+    std::vector<std::optional<T>> m_slots;
+    const size_t m_mask;
+
+    // indices only grow
+    alignas(cache_line) std::atomic_size_t m_head = 0; // written by the producer
+    size_t m_tail_cache = 0; // the producer's last view of m_tail
+
+    alignas(cache_line) std::atomic_size_t m_tail = 0; // written by the consumer
+    size_t m_head_cache = 0; // the consumer's last view of m_head
+    std::coroutine_handle<> m_parked_handle;
+
+    // a consumer which parks must see the last publish or the producer must see it parked
+    alignas(cache_line) std::atomic_bool m_parked = false;
+    std::atomic_bool m_closed = false;
+
+    bool empty() const noexcept {
+        return m_tail.load(std::memory_order_relaxed) == m_head.load(std::memory_order_acquire);
+    }
+
+    bool ready() const noexcept {
+        return !empty() || m_closed.load();
+    }
+
+    void publish(size_t h) {
+        m_head.store(h, std::memory_order_release);
+        wake_consumer();
+    }
+
+    void wake_consumer() {
+        // pairs with the fence after parking in wait
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!m_parked.load(std::memory_order_relaxed)) return;
+        if (!m_parked.exchange(false)) return;
+        m_consumer->post_call(resume_consumer, this);
+    }
+
+    static void resume_consumer(void* self) {
+        static_cast<spsc_channel*>(self)->m_parked_handle.resume();
+    }
+};
+
+} // namespace xeq
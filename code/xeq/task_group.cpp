@@ -0,0 +1,196 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "task_group.hpp"
+#include "co_spawn.hpp"
+
+#include <itlib/shared_from.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace xeq {
+
+struct task_group::impl : public itlib::enable_shared_from {
+    explicit impl(size_t max) : m_max(max) {}
+
+    struct waiter {
+        std::coroutine_handle<> handle;
+        executor_ptr ex;
+        void resume() {
+            ex->post_resume(handle);
+        }
+    };
+
+    struct child {
+        executor_ptr ex;
+        coro<void> c;
+    };
+
+    const size_t m_max;
+
+    mutable std::mutex m_mutex;
+    std::atomic_bool m_cancelled = false;
+    size_t m_running = 0;
+    std::deque<child> m_queued;
+    std::exception_ptr m_error;
+
+    std::optional<waiter> m_joiner;
+    std::deque<waiter> m_slot_waiters;
+
+    bool has_free_slot() const {
+        return !m_max || m_running + m_queued.size() < m_max;
+    }
+
+    // the following collect what is to be done out of the lock
+
+    struct actions {
+        std::optional<child> start;
+        std::deque<child> drop;
+        std::vector<waiter> wake;
+    };
+
+    void run(actions& a) {
+        a.drop.clear(); // destroys the frames
+        if (a.start) {
+            co_spawn(a.start->ex, run_child(shared_from(this), std::move(a.start->c)));
+        }
+        for (auto& w : a.wake) {
+            w.resume();
+        }
+    }
+
+    void cancel_locked(actions& a) {
+        m_cancelled = true;
+        a.drop = std::move(m_queued);
+        m_queued.clear();
+        for (auto& w : m_slot_waiters) {
+            a.wake.push_back(std::move(w));
+        }
+        m_slot_waiters.clear();
+    }
+
+    void wake_joiner_if_done(actions& a) {
+        if (m_running || !m_queued.empty() || !m_joiner) return;
+        a.wake.push_back(std::move(*m_joiner));
+        m_joiner.reset();
+    }
+
+    void spawn(const executor_ptr& ex, coro<void> c) {
+        actions a;
+        {
+            std::lock_guard l(m_mutex);
+            if (m_cancelled) {
+                a.drop.push_back({ex, std::move(c)});
+            }
+            else if (!m_max || m_running < m_max) {
+                ++m_running;
+                a.start.emplace(child{ex, std::move(c)});
+            }
+            else {
+                m_queued.push_back({ex, std::move(c)});
+            }
+        }
+        run(a);
+    }
+
+    void cancel() {
+        actions a;
+        {
+            std::lock_guard l(m_mutex);
+            cancel_locked(a);
+            wake_joiner_if_done(a);
+        }
+        run(a);
+    }
+
+    void on_done(coro_result<void>& r) {
+        actions a;
+        {
+            std::lock_guard l(m_mutex);
+            --m_running;
+            if (!r && !m_error) {
+                m_error = r.error();
+                cancel_locked(a);
+            }
+
+            if (!m_queued.empty()) {
+                ++m_running;
+                a.start.emplace(std::move(m_queued.front()));
+                m_queued.pop_front();
+            }
+            else if (!m_slot_waiters.empty()) {
+                a.wake.push_back(std::move(m_slot_waiters.front()));
+                m_slot_waiters.pop_front();
+            }
+
+            wake_joiner_if_done(a);
+        }
+        run(a);
+    }
+
+    static coro<void> run_child(std::shared_ptr<impl> self, coro<void> c) {
+        auto r = co_await c.safe_result();
+        self->on_done(r);
+    }
+};
+
+task_group::task_group(size_t max_running)
+    : m_impl(std::make_shared<impl>(max_running))
+{}
+
+task_group::~task_group() {
+    m_impl->cancel();
+}
+
+void task_group::spawn(const executor_ptr& ex, coro<void> c) {
+    m_impl->spawn(ex, std::move(c));
+}
+
+void task_group::cancel() {
+    m_impl->cancel();
+}
+
+bool task_group::cancelled() const noexcept {
+    return m_impl->m_cancelled;
+}
+
+size_t task_group::num_running() const {
+    std::lock_guard l(m_impl->m_mutex);
+    return m_impl->m_running;
+}
+
+size_t task_group::num_queued() const {
+    std::lock_guard l(m_impl->m_mutex);
+    return m_impl->m_queued.size();
+}
+
+bool task_group::suspend_join(std::coroutine_handle<> h, const executor_ptr& ex) {
+    std::lock_guard l(m_impl->m_mutex);
+    if (!m_impl->m_running && m_impl->m_queued.empty()) return false;
+    assert(!m_impl->m_joiner); // only one coroutine can join
+    m_impl->m_joiner.emplace(impl::waiter{h, ex});
+    return true;
+}
+
+bool task_group::suspend_for_slot(std::coroutine_handle<> h, const executor_ptr& ex) {
+    std::lock_guard l(m_impl->m_mutex);
+    if (m_impl->m_cancelled || m_impl->has_free_slot()) return false;
+    m_impl->m_slot_waiters.push_back({h, ex});
+    return true;
+}
+
+void task_group::rethrow_error() {
+    std::exception_ptr e;
+    {
+        std::lock_guard l(m_impl->m_mutex);
+        e = m_impl->m_error;
+    }
+    if (e) std::rethrow_exception(e);
+}
+
+} // namespace xeq
@@ -0,0 +1,110 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "api.h"
+#include "coro.hpp"
+#include "context.hpp"
+#include "executor.hpp"
+#include <cstddef>
+#include <exception>
+#include <memory>
+
+namespace xeq {
+
+// structured concurrency: a nursery of child coroutines
+//
+// task_group group(64); // at most 64 children run at once
+// for (auto& key : keys) {
+//     co_await group.wait_for_slot(); // backpressure: don't create more frames than can run
+//     group.spawn(ex, crawl(key));
+// }
+// co_await group.join(); // rethrows the first error of a child (on every join after it)
+//
+// children which are spawned when the limit is reached are queued and started when others finish
+// the first child which throws cancels the group:
+// * queued children are destroyed without running and new spawns are ignored
+// * running children can't be interrupted. They can check cancelled() to stop early
+// the exception is then rethrown from join
+//
+// destroying the group cancels it, but running children complete normally
+
+class XEQ_API task_group {
+public:
+    // 0 means no limit
+    explicit task_group(size_t max_running = 0);
+    ~task_group();
+
+    task_group(const task_group&) = delete;
+    task_group& operator=(const task_group&) = delete;
+
+    void spawn(const executor_ptr& ex, coro<void> c);
+    void spawn(context& ctx, coro<void> c) {
+        spawn(ctx.get_executor(), std::move(c));
+    }
+
+    void cancel();
+    bool cancelled() const noexcept;
+
+    size_t num_running() const;
+    size_t num_queued() const;
+
+    class join_awaitable {
+    public:
+        explicit join_awaitable(task_group& g) noexcept : m_group(g) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        template <typename PromiseType>
+        bool await_suspend(std::coroutine_handle<PromiseType> h) {
+            return m_group.suspend_join(h, h.promise().m_executor);
+        }
+
+        void await_resume() {
+            m_group.rethrow_error();
+        }
+
+    private:
+        task_group& m_group;
+    };
+
+    // resumes when all children have completed (or were dropped by a cancel)
+    // only one coroutine can join at a time
+    [[nodiscard]] join_awaitable join() noexcept {
+        return join_awaitable(*this);
+    }
+
+    class slot_awaitable {
+    public:
+        explicit slot_awaitable(task_group& g) noexcept : m_group(g) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        template <typename PromiseType>
+        bool await_suspend(std::coroutine_handle<PromiseType> h) {
+            return m_group.suspend_for_slot(h, h.promise().m_executor);
+        }
+
+        void await_resume() noexcept {}
+
+    private:
+        task_group& m_group;
+    };
+
+    // resumes when a spawn would start a child immediately or when the group is cancelled
+    [[nodiscard]] slot_awaitable wait_for_slot() noexcept {
+        return slot_awaitable(*this);
+    }
+
+    struct impl;
+private:
+    // return false if the coroutine doesn't need to suspend
+    bool suspend_join(std::coroutine_handle<> h, const executor_ptr& ex);
+    bool suspend_for_slot(std::coroutine_handle<> h, const executor_ptr& ex);
+
+    void rethrow_error();
+
+    std::shared_ptr<impl> m_impl; // shared with the running children
+};
+
+} // namespace xeq
@@ -3,6 +3,7 @@
 //
 #pragma once
 #include "thread_name.hpp"
+#include <chrono>
 #include <thread>
 #include <vector>
 #include <cassert>
@@ -17,26 +18,13 @@ public:
 
     template <typename Ctx>
     void start(Ctx& ctx, size_t n, std::string_view name = {}) {
-        assert(m_threads.empty());
-        if (!m_threads.empty()) return; // rescue
-        m_threads.reserve(n);
-        for (size_t i = 0; i < n; ++i) {
-            m_threads.push_back(std::thread([i, n, &ctx, name = std::string(name)]() mutable {
-                if (!name.empty()) {
-                    // set thread name if not empty
-                    if (n == 1) {
-                        set_this_thread_name(name);
-                    }
-                    else {
-                        name += ':';
-                        // maybe pad with 0 depending on log10(n) some day
-                        name += std::to_string(i);
-                        set_this_thread_name(name);
-                    }
-                }
-                ctx.run();
-            }));
-        }
+        start_threads(n, name, [&ctx] { ctx.run(); });
+    }
+
+    // run the threads with ctx.run_spin (see context::run_spin)
+    template <typename Ctx>
+    void start_spin(Ctx& ctx, size_t n, std::chrono::nanoseconds spin_budget, std::string_view name = {}) {
+        start_threads(n, name, [&ctx, spin_budget] { ctx.run_spin(spin_budget); });
     }
 
     void join() {
@@ -62,6 +50,31 @@ public:
     bool empty() const noexcept {
         return m_threads.empty();
     }
+
+private:
+    template <typename Run>
+    void start_threads(size_t n, std::string_view name, Run run) {
+        assert(m_threads.empty());
+        if (!m_threads.empty()) return; // rescue
+        m_threads.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            m_threads.push_back(std::thread([i, n, run, name = std::string(name)]() mutable {
+                if (!name.empty()) {
+                    // set thread name if not empty
+                    if (n == 1) {
+                        set_this_thread_name(name);
+                    }
+                    else {
+                        name += ':';
+                        // maybe pad with 0 depending on log10(n) some day
+                        name += std::to_string(i);
+                        set_this_thread_name(name);
+                    }
+                }
+                run();
+            }));
+        }
+    }
 };
 
 } // namespace xeq
@@ -5,6 +5,7 @@
 #include "api.h"
 #include "executor_ptr.hpp"
 #include "wait_func.hpp"
+#include "wait_node.hpp"
 #include "timeout.hpp"
 #include <chrono>
 #include <cstddef>
@@ -44,18 +45,28 @@ public:
 
     virtual void add_wait_cb(wait_func cb) = 0;
 
+    // the node must outlive the wait
+    virtual void add_wait_node(wait_node& node) = 0;
+
     static timer_ptr create(const executor_ptr& s);
 
     const executor_ptr& get_executor() const {
         return m_executor;
     }
+
+    // optional label which identifies the timer in the context lateness stats (see context::get_timer_stats)
+    // not copied: use string literals
+    void set_label(const char* label) noexcept { m_label = label; }
+    const char* label() const noexcept { return m_label; }
 private:
     // sealed interface
     timer(const executor_ptr& strand)
         : m_executor(strand)
     {}
     executor_ptr m_executor;
-    friend struct timer_impl;
+    const char* m_label = nullptr;
+    template <typename> friend struct timer_impl;
+    friend struct sim_timer;
 };
 
 } // namespace xeq
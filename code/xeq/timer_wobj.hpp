@@ -10,56 +10,87 @@
 
 namespace xeq {
 
-class timer_wobj {
+// the executor is an executor_ptr or a typed executor (see typed_executor.hpp)
+// the timer itself is created with the type-erased executor
+template <typename Executor>
+class basic_timer_wobj {
+    Executor m_executor;
     timer_ptr m_timer;
 public:
-    explicit timer_wobj(const executor_ptr& ex)
-        : m_timer(timer::create(ex))
+    explicit basic_timer_wobj(const Executor& ex)
+        : m_executor(ex)
+        , m_timer(timer::create(impl::erased_executor(ex)))
     {
         // the timer will be "hit" from potentially multiple threads
         // if the executor is not a strand itself,
         // this will cause races when notify_one and timer expiry happen at roughly the same time
         // a timer_wobj must be used with a strand
-        assert(ex->is_strand());
+        assert(impl::erased_executor(ex)->is_strand());
     }
 
-    const executor_ptr& get_executor() noexcept {
-        return m_timer->get_executor();
+    decltype(auto) get_executor() noexcept {
+        return impl::erased_executor(m_executor);
+    }
+
+    void set_label(const char* label) noexcept {
+        m_timer->set_label(label);
     }
 
     void notify_all() {
-        get_executor()->post([this] {
-            m_timer->cancel();
-        });
+        impl::executor_of(m_executor).post_call(do_notify_all, this);
     }
 
     void notify_one() {
-        get_executor()->post([this] {
-            m_timer->cancel_one();
-        });
+        impl::executor_of(m_executor).post_call(do_notify_one, this);
     }
 
     template <wait_func_class WF>
     void wait(WF&& cb) {
-        assert(get_executor()->running_in_this_thread());
+        assert(impl::executor_of(m_executor).running_in_this_thread());
         m_timer->expire_never();
         m_timer->add_wait_cb(std::forward<WF>(cb));
     }
 
     template <wait_func_class WF>
     void wait(timeout to, WF&& cb) {
-        assert(get_executor()->running_in_this_thread());
+        assert(impl::executor_of(m_executor).running_in_this_thread());
         m_timer->set_timeout(to);
         m_timer->add_wait_cb(std::forward<WF>(cb));
     }
 
+    void wait(wait_node& node) {
+        assert(impl::executor_of(m_executor).running_in_this_thread());
+        m_timer->expire_never();
+        m_timer->add_wait_node(node);
+    }
+
+    void wait(timeout to, wait_node& node) {
+        assert(impl::executor_of(m_executor).running_in_this_thread());
+        m_timer->set_timeout(to);
+        m_timer->add_wait_node(node);
+    }
+
     // corouitne interface implemented in coro_wobj.hpp
-    [[nodiscard]] wait_awaitable<timer_wobj> wait() {
+    [[nodiscard]] wait_awaitable<basic_timer_wobj> wait() {
         return wait_awaitable(*this);
     }
-    [[nodiscard]] timeout_awaitable<timer_wobj> wait(timeout to) {
+    [[nodiscard]] timeout_awaitable<basic_timer_wobj> wait(timeout to) {
         return timeout_awaitable(*this, to);
     }
+
+private:
+    static void do_notify_all(void* self) {
+        static_cast<basic_timer_wobj*>(self)->m_timer->cancel();
+    }
+    static void do_notify_one(void* self) {
+        static_cast<basic_timer_wobj*>(self)->m_timer->cancel_one();
+    }
+};
+
+// a class rather than an alias, so that it can be forward declared
+class timer_wobj : public basic_timer_wobj<executor_ptr> {
+public:
+    using basic_timer_wobj::basic_timer_wobj;
 };
 
 } // namespace xeq
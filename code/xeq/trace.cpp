@@ -0,0 +1,251 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include "trace.hpp"
+#include "thread_name.hpp"
+
+#include <itlib/data_mutex.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace xeq::trace {
+
+std::atomic_bool g_enabled = false;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+enum class event_type : uint8_t {
+    post, start, end
+};
+
+struct event {
+    clock_type::time_point time;
+    uint64_t task;
+    const void* exec;
+    const char* label;
+    event_type type;
+};
+
+class ring {
+public:
+    ring(uint32_t tid, uint32_t capacity, std::string thread_name)
+        : m_tid(tid)
+        , m_thread_name(std::move(thread_name))
+        , m_mask(capacity - 1)
+        , m_events(capacity)
+    {}
+
+    // writer (owner thread)
+    void push(const event& e) {
+        auto h = m_head.load(std::memory_order_relaxed);
+        if (h - m_tail.load(std::memory_order_acquire) == m_events.size()) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        m_events[h & m_mask] = e;
+        m_head.store(h + 1, std::memory_order_release);
+    }
+
+    // reader (flush)
+    template <typename F>
+    size_t drain(F f) {
+        auto t = m_tail.load(std::memory_order_relaxed);
+        const auto h = m_head.load(std::memory_order_acquire);
+        const auto ret = size_t(h - t);
+        for (; t != h; ++t) {
+            f(m_events[t & m_mask]);
+        }
+        m_tail.store(t, std::memory_order_release);
+        return ret;
+    }
+
+    const uint32_t m_tid;
+    const std::string m_thread_name;
+    std::atomic_uint64_t m_dropped = 0;
+    std::atomic_bool m_thread_exited = false;
+
+private:
+    const uint64_t m_mask;
+    std::vector<event> m_events;
+    std::atomic_uint64_t m_head = 0;
+    std::atomic_uint64_t m_tail = 0;
+};
+
+struct registry {
+    std::vector<std::shared_ptr<ring>> rings;
+    uint32_t next_tid = 1;
+    uint64_t dropped_by_retired = 0; // from rings of exited threads which were removed
+};
+itlib::data_mutex<registry, std::mutex> g_registry;
+
+// the rings have a single reader, so flushes are serialized
+std::mutex g_flush_mutex;
+
+std::atomic_uint32_t g_ring_capacity = 1 << 16;
+std::atomic_uint64_t g_next_task = 1;
+clock_type::time_point g_epoch = clock_type::now();
+
+// marks the ring for removal when the thread exits
+struct thread_ring {
+    std::shared_ptr<ring> r;
+    ~thread_ring() {
+        if (r) r->m_thread_exited = true;
+    }
+};
+thread_local thread_ring t_ring;
+thread_local const char* t_label = nullptr;
+
+ring& this_thread_ring() {
+    if (!t_ring.r) {
+        uint32_t cap = 1;
+        while (cap < g_ring_capacity.load(std::memory_order_relaxed)) cap <<= 1;
+        auto reg = g_registry.unique_lock();
+        t_ring.r = std::make_shared<ring>(reg->next_tid++, cap, get_this_thread_name());
+        reg->rings.push_back(t_ring.r);
+    }
+    return *t_ring.r;
+}
+
+void record(event_type type, uint64_t task, const void* exec, const char* label) {
+    this_thread_ring().push({clock_type::now(), task, exec, label, type});
+}
+
+void write_json_string(std::ostream& out, const char* str) {
+    static constexpr char hex[] = "0123456789abcdef";
+    out << '"';
+    for (auto p = str; *p; ++p) {
+        const auto c = static_cast<unsigned char>(*p);
+        if (c < 0x20) {
+            // control characters must be escaped in json
+            out << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+            continue;
+        }
+        if (c == '"' || c == '\\') out << '\\';
+        out << *p;
+    }
+    out << '"';
+}
+
+} // namespace
+
+void start(uint32_t events_per_thread) {
+    g_ring_capacity.store(events_per_thread ? events_per_thread : 1, std::memory_order_relaxed);
+    g_enabled.store(true, std::memory_order_relaxed);
+}
+
+void stop() {
+    g_enabled.store(false, std::memory_order_relaxed);
+}
+
+scoped_label::scoped_label(const char* label) noexcept
+    : m_prev(std::exchange(t_label, label))
+{}
+
+scoped_label::~scoped_label() {
+    t_label = m_prev;
+}
+
+ufunc<void()> traced_post(const void* exec, ufunc<void()> func) {
+    const auto task = g_next_task.fetch_add(1, std::memory_order_relaxed);
+    const auto label = t_label;
+    record(event_type::post, task, exec, label);
+    return [task, exec, label, func = std::move(func)]() mutable {
+        record(event_type::start, task, exec, label);
+        scoped_label l(label);
+        func();
+        // the task may have been the one to stop tracing, but we want to close the slice anyway
+        record(event_type::end, task, exec, label);
+    };
+}
+
+size_t write_chrome_trace(std::ostream& out) {
+    std::lock_guard flush_lock(g_flush_mutex);
+
+    std::vector<std::shared_ptr<ring>> rings, exited;
+    {
+        auto reg = g_registry.unique_lock();
+        rings = reg->rings;
+    }
+    // rings of threads which have exited before the drain can be forgotten after it
+    for (auto& r : rings) {
+        if (r->m_thread_exited) exited.push_back(r);
+    }
+
+    const auto flags = out.flags();
+
+    size_t ret = 0;
+    bool first = true;
+    auto sep = [&]() -> std::ostream& {
+        if (!first) out << ",\n";
+        first = false;
+        return out;
+    };
+
+    out << "{\"traceEvents\":[\n";
+    for (auto& r : rings) {
+        if (!r->m_thread_name.empty()) {
+            sep() << R"({"ph":"M","name":"thread_name","pid":1,"tid":)" << r->m_tid << R"(,"args":{"name":)";
+            write_json_string(out, r->m_thread_name.c_str());
+            out << "}}";
+        }
+
+        ret += r->drain([&](const event& e) {
+            const auto us = std::chrono::duration<double, std::micro>(e.time - g_epoch).count();
+            auto& o = sep();
+            o << R"({"pid":1,"tid":)" << r->m_tid << R"(,"ts":)" << std::fixed << us << R"(,"name":)";
+            write_json_string(o, e.label ? e.label : "task");
+            switch (e.type) {
+            case event_type::post:
+                // flow start, bound to the enclosing slice on the posting thread
+                o << R"(,"ph":"s","cat":"post","id":)" << e.task;
+                break;
+            case event_type::start:
+                o << R"(,"ph":"B","cat":"task","args":{"task":)" << e.task
+                    << R"(,"executor":")" << e.exec << R"("}},)";
+                // flow end, bound to the slice which starts here
+                o << R"({"pid":1,"tid":)" << r->m_tid << R"(,"ts":)" << us
+                    << R"(,"name":)";
+                write_json_string(o, e.label ? e.label : "task");
+                o << R"(,"ph":"f","bp":"e","cat":"post","id":)" << e.task;
+                break;
+            case event_type::end:
+                o << R"(,"ph":"E","cat":"task")";
+                break;
+            }
+            o << '}';
+        });
+    }
+    out << "\n]}\n";
+    out.flags(flags);
+
+    if (!exited.empty()) {
+        auto reg = g_registry.unique_lock();
+        std::erase_if(reg->rings, [&](const std::shared_ptr<ring>& r) {
+            if (std::find(exited.begin(), exited.end(), r) == exited.end()) return false;
+            reg->dropped_by_retired += r->m_dropped.load(std::memory_order_relaxed);
+            return true;
+        });
+    }
+
+    return ret;
+}
+
+uint64_t dropped_events() noexcept {
+    auto reg = g_registry.unique_lock();
+    auto ret = reg->dropped_by_retired;
+    for (auto& r : reg->rings) {
+        ret += r->m_dropped.load(std::memory_order_relaxed);
+    }
+    return ret;
+}
+
+} // namespace xeq::trace
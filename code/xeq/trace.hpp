@@ -0,0 +1,60 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "api.h"
+#include "ufunc.hpp"
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+
+// timeline tracing of handlers and coroutine resumes posted through xeq executors
+//
+// when enabled, every post gets a task id, and every thread records post, start, and end events for the tasks
+// it touches in its own lock-free ring buffer (single writer, single reader: the flush)
+// a full ring drops events instead of overwriting unflushed ones
+//
+// write_chrome_trace drains the rings into a Chrome JSON trace (chrome://tracing, https://ui.perfetto.dev)
+// starts and ends are slices on the executing thread and posts are flow arrows to them
+//
+// when disabled, the overhead of a post is a single branch on a relaxed atomic load
+
+namespace xeq::trace {
+
+XEQ_API extern std::atomic_bool g_enabled;
+
+inline bool enabled() noexcept {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+// rings created after this call have events_per_thread capacity (rounded up to a power of two)
+XEQ_API void start(uint32_t events_per_thread = 1 << 16);
+XEQ_API void stop();
+
+// posts made while a label is set are labeled with it
+// tasks run with their label set, so the posts they make inherit it
+// labels are not copied: use string literals
+class scoped_label {
+public:
+    XEQ_API explicit scoped_label(const char* label) noexcept;
+    XEQ_API ~scoped_label();
+
+    scoped_label(const scoped_label&) = delete;
+    scoped_label& operator=(const scoped_label&) = delete;
+private:
+    const char* m_prev;
+};
+
+// writes all events recorded since the last flush
+// concurrent calls are serialized
+// returns the number of written events
+XEQ_API size_t write_chrome_trace(std::ostream& out);
+
+// events which were not recorded because a ring was full
+XEQ_API uint64_t dropped_events() noexcept;
+
+// used by executors: records the post and wraps the function to record its start and end
+// exec identifies the executor (strand) which the task is posted to
+XEQ_API ufunc<void()> traced_post(const void* exec, ufunc<void()> func);
+
+} // namespace xeq::trace
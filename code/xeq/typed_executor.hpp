@@ -0,0 +1,147 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "context.hpp"
+#include "executor.hpp"
+#include "handler_allocator.hpp"
+#include "trace.hpp"
+#include "ufunc.hpp"
+
+// unlike the rest of xeq, this header includes asio
+// asio is a private dependency of xeq, so code which includes it must link to it (Boost::asio) itself
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <cassert>
+#include <coroutine>
+#include <type_traits>
+#include <utility>
+
+namespace xeq {
+
+// statically typed handles to the executors of a context
+//
+// context_executor_ref ex(ctx);
+// context_strand strand(ctx);
+// post(ex, [] { ... });
+// co_spawn(strand, session());
+// basic_simple_wobj wobj(strand);
+//
+// executor_ptr goes through the virtual executor interface. These are concrete types which post to asio directly
+// and are visible to the compiler, so the scheduling path can be inlined. post takes any callable, so it doesn't
+// allocate a type-erased function either
+// when the executor is traced, bounded or has a memory account, they forward to the type-erased executor,
+// so the behavior is the same
+// the type-erased executor is still available for coroutines and everything else which stores an executor_ptr
+
+namespace impl {
+template <typename AsioExecutor>
+class typed_executor_base {
+public:
+    template <typename Func>
+    void post(Func&& func) const {
+        if (needs_erased()) [[unlikely]] {
+            return m_executor->post(ufunc<void()>(std::forward<Func>(func)));
+        }
+        boost::asio::post(m_aexec, with_handler_allocator<std::decay_t<Func>>{std::forward<Func>(func)});
+    }
+
+    void post_resume(std::coroutine_handle<> handle) const {
+        if (needs_erased()) [[unlikely]] {
+            return m_executor->post_resume(handle);
+        }
+        boost::asio::post(m_aexec, with_handler_allocator{[=]() {
+            handle.resume();
+        }});
+    }
+
+    void post_call(void (*func)(void*), void* arg) const {
+        if (needs_erased()) [[unlikely]] {
+            return m_executor->post_call(func, arg);
+        }
+        boost::asio::post(m_aexec, with_handler_allocator{[=]() {
+            func(arg);
+        }});
+    }
+
+    bool running_in_this_thread() const noexcept {
+        return m_aexec.running_in_this_thread();
+    }
+
+    const AsioExecutor& as_asio_executor() const noexcept { return m_aexec; }
+
+protected:
+    typed_executor_base(executor& ex, AsioExecutor aex) noexcept
+        : m_executor(&ex)
+        , m_aexec(std::move(aex))
+    {}
+
+private:
+    // the type-erased executor wraps the posts in these cases
+    bool needs_erased() const noexcept {
+        return trace::enabled() || m_executor->get_bounds() || m_executor->get_memory_account();
+    }
+
+    executor* m_executor;
+    AsioExecutor m_aexec;
+};
+} // namespace impl
+
+class context_executor_ref : public impl::typed_executor_base<boost::asio::io_context::executor_type> {
+public:
+    // the handle is a pointer: it must not outlive the context
+    explicit context_executor_ref(context& ctx) noexcept
+        : typed_executor_base(*ctx.get_executor(), ctx.as_asio_io_context().get_executor())
+        , m_erased(&ctx.get_executor())
+    {}
+
+    const executor_ptr& get_executor() const noexcept { return *m_erased; }
+
+private:
+    const executor_ptr* m_erased;
+};
+
+// a strand of a context
+class context_strand : public impl::typed_executor_base<boost::asio::strand<boost::asio::io_context::executor_type>> {
+public:
+    using asio_strand = boost::asio::strand<boost::asio::io_context::executor_type>;
+
+    // makes a new strand
+    explicit context_strand(context& ctx)
+        : context_strand(ctx.make_strand())
+    {}
+
+    const strand_ptr& get_executor() const noexcept { return m_strand; }
+
+private:
+    explicit context_strand(strand_ptr s)
+        : typed_executor_base(*s, asio_strand_of(*s))
+        , m_strand(std::move(s))
+    {}
+
+    // a copy of an asio strand is the same strand
+    static asio_strand asio_strand_of(strand& s) {
+        auto aex = s.as_asio_executor();
+        auto ret = aex.target<asio_strand>();
+        assert(ret); // strands of a context are asio strands
+        return *ret;
+    }
+
+    strand_ptr m_strand;
+};
+
+// free functions, so that generic code can take any kind of executor
+
+inline void post(const executor_ptr& ex, ufunc<void()> func) {
+    ex->post(std::move(func));
+}
+
+template <typename AsioExecutor, typename Func>
+void post(const impl::typed_executor_base<AsioExecutor>& ex, Func&& func) {
+    ex.post(std::forward<Func>(func));
+}
+
+} // namespace xeq
@@ -0,0 +1,27 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "error_code.hpp"
+#include <system_error>
+
+namespace xeq {
+
+// an intrusive alternative to wait_func
+// the node lives in the waiter (typically an awaitable in a coroutine frame) and must outlive the wait
+// waiting through a node needs no type-erased callback, thus no allocation
+struct wait_node {
+    using complete_func = void (*)(wait_node& self, const error_code& ec);
+    complete_func complete;
+    error_code result = {}; // scratch space for wait objects which complete the node after a hop
+};
+
+inline void wait_node_complete_timeout(wait_node& node) {
+    node.complete(node, {});
+}
+
+inline void wait_node_complete_cancelled(wait_node& node) {
+    node.complete(node, std::make_error_code(std::errc::operation_canceled));
+}
+
+} // namespace xeq
@@ -5,18 +5,35 @@
 #include "executor.hpp"
 #include "work_guard.hpp"
 #include "timer.hpp"
+#include "handler_allocator.hpp"
+#include "trace.hpp"
+#include "memory_account.hpp"
+#include "executor_bounds.hpp"
+#include "impl/accounted_handler.hpp"
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/asio/post.hpp>
 #include <boost/asio/any_io_executor.hpp>
 #include <boost/asio/steady_timer.hpp>
+#include <boost/asio/bind_executor.hpp>
 
 #include <itlib/shared_from.hpp>
 #include <itlib/make_ptr.hpp>
 #include <itlib/data_mutex.hpp>
 
 #include <variant>
+#include <mutex>
+#include <cassert>
+#include <atomic>
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#   include <immintrin.h>
+#   define XEQ_X86 1
+#endif
 
 namespace asio = boost::asio;
 using asio_strand = asio::strand<asio::io_context::executor_type>;
@@ -39,23 +56,179 @@ using tsumap = std::unordered_map<
 >;
 }
 
+namespace {
+// lock-free except for the rare update of the worst offenders
+class timer_lateness_recorder {
+public:
+    using stats = context::timer_stats;
+
+    void record(stats::duration lateness, stats::time_point expiry, const char* label) noexcept {
+        if (lateness.count() < 0) lateness = {};
+        const auto ns = uint64_t(lateness.count());
+
+        const auto us = ns / 1000;
+        const auto bucket = std::min(size_t(std::bit_width(us)), stats::num_buckets - 1);
+        m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_total.fetch_add(ns, std::memory_order_relaxed);
+
+        auto max = m_max.load(std::memory_order_relaxed);
+        while (ns > max && !m_max.compare_exchange_weak(max, ns, std::memory_order_relaxed));
+
+        if (ns <= m_worst_threshold.load(std::memory_order_relaxed)) return;
+
+        auto w = m_worst.unique_lock();
+        auto& list = w->list;
+        auto& num = w->num;
+        if (num == stats::max_offenders) {
+            if (lateness <= list[num - 1].lateness) return; // lost a race
+            --num;
+        }
+        auto pos = num;
+        while (pos > 0 && list[pos - 1].lateness < lateness) {
+            list[pos] = list[pos - 1];
+            --pos;
+        }
+        list[pos] = {lateness, expiry, label};
+        ++num;
+        if (num == stats::max_offenders) {
+            m_worst_threshold.store(uint64_t(list[num - 1].lateness.count()), std::memory_order_relaxed);
+        }
+    }
+
+    stats get() const noexcept {
+        stats ret = {};
+        for (size_t i = 0; i < stats::num_buckets; ++i) {
+            ret.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        }
+        ret.count = m_count.load(std::memory_order_relaxed);
+        ret.total = stats::duration(m_total.load(std::memory_order_relaxed));
+        ret.max = stats::duration(m_max.load(std::memory_order_relaxed));
+        auto w = m_worst.unique_lock();
+        std::copy(w->list, w->list + w->num, ret.worst);
+        ret.num_worst = w->num;
+        return ret;
+    }
+
+    void reset() noexcept {
+        auto w = m_worst.unique_lock();
+        for (auto& b : m_buckets) b.store(0, std::memory_order_relaxed);
+        m_count.store(0, std::memory_order_relaxed);
+        m_total.store(0, std::memory_order_relaxed);
+        m_max.store(0, std::memory_order_relaxed);
+        m_worst_threshold.store(0, std::memory_order_relaxed);
+        w->num = 0;
+    }
+
+private:
+    std::atomic_uint64_t m_buckets[stats::num_buckets] = {};
+    std::atomic_uint64_t m_count = 0;
+    std::atomic_uint64_t m_total = 0; // ns
+    std::atomic_uint64_t m_max = 0; // ns
+
+    // ns, only offenders later than this can enter the full list
+    std::atomic_uint64_t m_worst_threshold = 0;
+    struct worst_list {
+        stats::offender list[stats::max_offenders];
+        size_t num = 0;
+    };
+    itlib::data_mutex<worst_list, std::mutex> m_worst;
+};
+
+// a service of the io_context of every context
+// the timers find it through the asio execution context of their executor, so that any executor can be used for them,
+// but those of a context get the io_context and its lateness stats
+class context_timer_service final : public asio::execution_context::service {
+public:
+    static inline asio::execution_context::id id;
+
+    // only made by the context (the timers check for it before they use it)
+    // asio requires the constructor from an owner only
+    explicit context_timer_service(asio::execution_context& owner, asio::io_context* ioc = nullptr)
+        : asio::execution_context::service(owner)
+        , m_ioc(ioc)
+    {}
+
+    asio::io_context* m_ioc;
+    timer_lateness_recorder m_lateness;
+
+private:
+    virtual void shutdown() override {}
+};
+} // namespace
+
 struct context::impl : public asio::io_context {
-    impl() {
+    impl()
+        : m_timers(asio::make_service<context_timer_service>(*this, this))
+    {
         init_executor();
     }
     impl(int concurrency_hint)
         : asio::io_context(concurrency_hint)
+        , m_timers(asio::make_service<context_timer_service>(*this, this))
     {
         init_executor();
     }
 
     void init_executor();
     executor_ptr m_executor;
-    itlib::data_mutex<tsumap<std::shared_ptr<void>>, std::mutex> m_objects;
+
+    struct attached_object {
+        std::shared_ptr<void> obj;
+        uint32_t slot;
+    };
+    // the generation is bumped on detach, before the slot can be reused
+    // a new object is stored after that, so a reader which sees it will also see the new generation
+    struct object_slot {
+        std::atomic<void*> ptr = nullptr;
+        std::atomic_uint32_t generation = 0;
+    };
+
+    struct object_registry {
+        tsumap<attached_object> by_name;
+        uint32_t next_slot = 0;
+        std::vector<uint32_t> free_slots;
+        std::vector<std::unique_ptr<object_slot[]>> slot_blocks;
+    };
+    itlib::data_mutex<object_registry, std::mutex> m_objects;
+
+    // two-level slot table so that the blocks never move and readers need no lock
+    // blocks are only added (under the registry lock) and live as long as the context
+    static constexpr uint32_t slot_block_size = 256;
+    static constexpr uint32_t max_slot_blocks = 256;
+    std::atomic<object_slot*> m_slot_blocks[max_slot_blocks] = {};
+
+    std::atomic_uint64_t m_spin_hits = 0;
+    std::atomic_uint64_t m_parks = 0;
+
+    std::atomic_bool m_stop_requested = false; // by context::stop, until reset
+
+    // threads in run, poll, or run_spin
+    std::atomic_int m_runners = 0;
+    struct runner_scope {
+        impl& ctx;
+        explicit runner_scope(impl& c) noexcept : ctx(c) { ctx.m_runners.fetch_add(1, std::memory_order_relaxed); }
+        ~runner_scope() { ctx.m_runners.fetch_sub(1, std::memory_order_relaxed); }
+    };
+
+    context_timer_service& m_timers;
+
+    object_slot& slot_ref(uint32_t slot) const noexcept {
+        auto block = m_slot_blocks[slot / slot_block_size].load(std::memory_order_acquire);
+        return block[slot % slot_block_size];
+    }
 };
 
 namespace {
 
+void cpu_relax() noexcept {
+#if defined(XEQ_X86)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
 class context_executor final : public executor, public itlib::enable_shared_from {
 public:
     asio::io_context::executor_type m_aexec;
@@ -64,13 +237,40 @@ public:
     {}
 
     virtual void post(ufunc<void()> func) override {
-        asio::post(m_aexec, std::move(func));
+        if (trace::enabled()) [[unlikely]] {
+            func = trace::traced_post(this, std::move(func));
+        }
+        if (auto& b = get_bounds()) [[unlikely]] {
+            func = b->track(std::move(func));
+        }
+        if (auto& acct = get_memory_account()) [[unlikely]] {
+            return asio::post(m_aexec, impl::accounted_handler{std::move(func), acct});
+        }
+        asio::post(m_aexec, with_handler_allocator{std::move(func)});
     }
 
     virtual void post_resume(std::coroutine_handle<> handle) override {
-        asio::post(m_aexec, [=]() {
+        if (trace::enabled() || get_bounds()) [[unlikely]] {
+            return post([=] { handle.resume(); });
+        }
+        if (auto& acct = get_memory_account()) [[unlikely]] {
+            return asio::post(m_aexec, impl::accounted_handler{[=]() { handle.resume(); }, acct});
+        }
+        asio::post(m_aexec, with_handler_allocator{[=]() {
             handle.resume();
-        });
+        }});
+    }
+
+    virtual void post_call(void (*func)(void*), void* arg) override {
+        if (trace::enabled() || get_bounds()) [[unlikely]] {
+            return post([=] { func(arg); });
+        }
+        if (auto& acct = get_memory_account()) [[unlikely]] {
+            return asio::post(m_aexec, impl::accounted_handler{[=]() { func(arg); }, acct});
+        }
+        asio::post(m_aexec, with_handler_allocator{[=]() {
+            func(arg);
+        }});
     }
 
     virtual bool is_strand() const noexcept override { return false; }
@@ -97,12 +297,39 @@ public:
         : m_astrand(std::move(s))
     {}
     virtual void post(ufunc<void()> func) override {
-        asio::post(m_astrand, std::move(func));
+        if (trace::enabled()) [[unlikely]] {
+            func = trace::traced_post(this, std::move(func));
+        }
+        if (auto& b = get_bounds()) [[unlikely]] {
+            func = b->track(std::move(func));
+        }
+        if (auto& acct = get_memory_account()) [[unlikely]] {
+            return asio::post(m_astrand, impl::accounted_handler{std::move(func), acct});
+        }
+        asio::post(m_astrand, with_handler_allocator{std::move(func)});
     }
     virtual void post_resume(std::coroutine_handle<> handle) override {
-        asio::post(m_astrand, [=]() {
+        if (trace::enabled() || get_bounds()) [[unlikely]] {
+            return post([=] { handle.resume(); });
+        }
+        if (auto& acct = get_memory_account()) [[unlikely]] {
+            return asio::post(m_astrand, impl::accounted_handler{[=]() { handle.resume(); }, acct});
+        }
+        asio::post(m_astrand, with_handler_allocator{[=]() {
             handle.resume();
-        });
+        }});
+    }
+
+    virtual void post_call(void (*func)(void*), void* arg) override {
+        if (trace::enabled() || get_bounds()) [[unlikely]] {
+            return post([=] { func(arg); });
+        }
+        if (auto& acct = get_memory_account()) [[unlikely]] {
+            return asio::post(m_astrand, impl::accounted_handler{[=]() { func(arg); }, acct});
+        }
+        asio::post(m_astrand, with_handler_allocator{[=]() {
+            func(arg);
+        }});
     }
 
     executor_ptr get_super_executor() noexcept override {
@@ -124,7 +351,9 @@ public:
 };
 
 strand_ptr context_executor::make_strand() {
-    return std::make_shared<strand_executor>(asio::make_strand(m_aexec));
+    auto ret = std::make_shared<strand_executor>(asio::make_strand(m_aexec));
+    ret->set_memory_account(get_memory_account());
+    return ret;
 }
 
 } // namespace
@@ -133,6 +362,79 @@ strand_ptr context_executor::make_strand() {
 strand::~strand() = default;
 executor::~executor() = default;
 
+namespace {
+// values are set rarely (typically once per key and executor), so all storages share a lock
+std::mutex g_local_storage_mutex;
+}
+
+executor_local_storage::~executor_local_storage() {
+    clear();
+    auto blocks = m_blocks.load(std::memory_order_relaxed);
+    if (!blocks) return;
+    for (uint32_t i = 0; i < max_blocks; ++i) {
+        delete[] blocks[i].load(std::memory_order_relaxed);
+    }
+    delete[] blocks;
+}
+
+void executor_local_storage::clear() noexcept {
+    auto blocks = m_blocks.load(std::memory_order_acquire);
+    if (!blocks) return;
+
+    std::vector<std::pair<void*, destroy_func>> cleared; // destroyed outside of the lock
+    {
+        std::lock_guard l(g_local_storage_mutex);
+        for (uint32_t i = 0; i < max_blocks; ++i) {
+            auto block = blocks[i].load(std::memory_order_relaxed);
+            if (!block) continue;
+            for (uint32_t j = 0; j < block_size; ++j) {
+                auto& v = block[j];
+                if (auto p = v.ptr.exchange(nullptr, std::memory_order_relaxed)) {
+                    cleared.emplace_back(p, v.destroy);
+                }
+            }
+        }
+    }
+    for (auto& [p, destroy] : cleared) {
+        destroy(p);
+    }
+}
+
+void executor_local_storage::set(uint32_t slot, void* ptr, destroy_func destroy) {
+    if (slot >= max_slots) {
+        if (ptr) destroy(ptr);
+        throw std::runtime_error("xeq::executor_local: too many keys");
+    }
+
+    void* old_ptr;
+    destroy_func old_destroy;
+    {
+        std::lock_guard l(g_local_storage_mutex);
+        auto blocks = m_blocks.load(std::memory_order_relaxed);
+        if (!blocks) {
+            if (!ptr) return; // nothing to reset
+            blocks = new block_ptr[max_blocks]();
+            m_blocks.store(blocks, std::memory_order_release);
+        }
+        auto& bp = blocks[slot / block_size];
+        auto block = bp.load(std::memory_order_relaxed);
+        if (!block) {
+            if (!ptr) return;
+            block = new value[block_size];
+            bp.store(block, std::memory_order_release);
+        }
+        auto& v = block[slot % block_size];
+        old_destroy = std::exchange(v.destroy, destroy);
+        old_ptr = v.ptr.exchange(ptr, std::memory_order_acq_rel);
+    }
+    if (old_ptr) old_destroy(old_ptr);
+}
+
+uint32_t executor_local_storage::new_slot() noexcept {
+    static std::atomic_uint32_t next_slot = 0;
+    return next_slot.fetch_add(1, std::memory_order_relaxed);
+}
+
 struct work_guard_impl {
     std::variant<
         asio::executor_work_guard<asio::io_context::executor_type>,
@@ -140,6 +442,10 @@ struct work_guard_impl {
     > wg;
 };
 
+void executor::post_call(void (*func)(void*), void* arg) {
+    post([=] { func(arg); });
+}
+
 work_guard executor::make_work_guard() {
     return itlib::make_shared(work_guard_impl{
         boost::asio::make_work_guard(as_asio_executor())
@@ -161,14 +467,67 @@ context::context(int concurrency_hint) : m_impl(std::make_unique<impl>(concurren
 context::~context() = default;
 
 size_t context::run() {
+    impl::runner_scope rs(*m_impl);
     return m_impl->run();
 }
 
 size_t context::poll() {
+    impl::runner_scope rs(*m_impl);
     return m_impl->poll();
 }
 
+size_t context::run_spin(std::chrono::nanoseconds spin_budget) {
+    using clock = std::chrono::steady_clock;
+    auto& ctx = *m_impl;
+    impl::runner_scope rs(ctx);
+    size_t ret = 0;
+
+    while (true) {
+        auto n = ctx.poll();
+        if (n) {
+            ret += n;
+            continue;
+        }
+        if (ctx.stopped()) return ret;
+
+        const auto spin_end = clock::now() + spin_budget;
+        while (clock::now() < spin_end) {
+            // a poll is a non-blocking reactor run (a syscall), so don't do it on every iteration
+            for (int i = 0; i < 16; ++i) cpu_relax();
+            n = ctx.poll();
+            if (n || ctx.stopped()) break;
+        }
+        if (n) {
+            ctx.m_spin_hits.fetch_add(1, std::memory_order_relaxed);
+            ret += n;
+            continue;
+        }
+        if (ctx.stopped()) return ret;
+
+        ctx.m_parks.fetch_add(1, std::memory_order_relaxed);
+        n = ctx.run_one();
+        if (!n) return ret; // stopped or out of work
+        ret += n;
+    }
+}
+
+context::timer_stats context::get_timer_stats() const noexcept {
+    return m_impl->m_timers.m_lateness.get();
+}
+
+void context::reset_timer_stats() noexcept {
+    m_impl->m_timers.m_lateness.reset();
+}
+
+context::spin_stats context::get_spin_stats() const noexcept {
+    return {
+        m_impl->m_spin_hits.load(std::memory_order_relaxed),
+        m_impl->m_parks.load(std::memory_order_relaxed)
+    };
+}
+
 void context::stop() {
+    m_impl->m_stop_requested.store(true, std::memory_order_relaxed);
     m_impl->stop();
 }
 
@@ -180,10 +539,48 @@ void context::restart() {
     m_impl->restart();
 }
 
+bool context::reset() {
+    decltype(impl::object_registry::by_name) detached; // destroyed after the lock is released
+    {
+        auto objects = m_impl->m_objects.unique_lock();
+        for (auto& [name, obj] : objects->by_name) {
+            auto& s = m_impl->slot_ref(obj.slot);
+            s.ptr.store(nullptr, std::memory_order_release);
+            s.generation.fetch_add(1, std::memory_order_release);
+            objects->free_slots.push_back(obj.slot);
+        }
+        detached.swap(objects->by_name);
+    }
+
+    auto& ex = *m_impl->m_executor;
+    ex.local_storage().clear();
+    ex.set_bounds({});
+    ex.set_memory_account({});
+    reset_timer_stats();
+    m_impl->m_spin_hits.store(0, std::memory_order_relaxed);
+    m_impl->m_parks.store(0, std::memory_order_relaxed);
+
+    return !m_impl->m_stop_requested.exchange(false, std::memory_order_relaxed);
+}
+
 const executor_ptr& context::get_executor() const noexcept {
     return m_impl->m_executor;
 }
 
+const memory_account_ptr& context::enable_memory_accounting() {
+    // the executors read the account without synchronization
+    assert(m_impl->m_runners.load(std::memory_order_relaxed) == 0 && "enable memory accounting before the context runs");
+    auto& ex = *m_impl->m_executor;
+    if (!ex.get_memory_account()) {
+        ex.set_memory_account(std::make_shared<memory_account>());
+    }
+    return ex.get_memory_account();
+}
+
+const memory_account_ptr& context::get_memory_account() const noexcept {
+    return m_impl->m_executor->get_memory_account();
+}
+
 strand_ptr context::make_strand() {
     return m_impl->m_executor->make_strand();
 }
@@ -192,41 +589,127 @@ boost::asio::io_context& context::as_asio_io_context() noexcept {
     return *m_impl;
 }
 
-void context::attach_object(std::string_view name, std::shared_ptr<void> obj) {
+const char* context::backend_name() noexcept {
+#if defined(BOOST_ASIO_HAS_IO_URING_AS_DEFAULT)
+    return "io_uring";
+#elif defined(BOOST_ASIO_HAS_IOCP)
+    return "iocp";
+#elif defined(BOOST_ASIO_HAS_EPOLL)
+    return "epoll";
+#elif defined(BOOST_ASIO_HAS_KQUEUE)
+    return "kqueue";
+#elif defined(BOOST_ASIO_HAS_DEV_POLL)
+    return "/dev/poll";
+#else
+    return "select";
+#endif
+}
+
+context::key<void> context::attach_object_slot(std::string_view name, std::shared_ptr<void> obj) {
+    auto objects = m_impl->m_objects.unique_lock();
     // throw if already exists
-    auto [_, inserted] = m_impl->m_objects.unique_lock()->emplace(std::string(name), std::move(obj));
-    if (!inserted) {
+    if (objects->by_name.find(name) != objects->by_name.end()) {
         throw std::runtime_error("xeq::context::attach_object: object with name '" + std::string(name) + "' already exists");
     }
+
+    uint32_t slot;
+    if (!objects->free_slots.empty()) {
+        slot = objects->free_slots.back();
+    }
+    else {
+        slot = objects->next_slot;
+        const auto block_index = slot / impl::slot_block_size;
+        if (block_index == impl::max_slot_blocks) {
+            throw std::runtime_error("xeq::context::attach_object: out of object slots");
+        }
+        if (block_index == objects->slot_blocks.size()) {
+            auto& block = objects->slot_blocks.emplace_back(std::make_unique<impl::object_slot[]>(impl::slot_block_size));
+            m_impl->m_slot_blocks[block_index].store(block.get(), std::memory_order_release);
+        }
+        // so that detach (noexcept) never allocates
+        objects->free_slots.reserve(slot + 1);
+    }
+
+    auto& s = m_impl->slot_ref(slot);
+    const auto ptr = obj.get();
+    objects->by_name.emplace(std::string(name), impl::attached_object{std::move(obj), slot});
+
+    // nothing throws from here on
+    if (slot == objects->next_slot) ++objects->next_slot;
+    else objects->free_slots.pop_back();
+    s.ptr.store(ptr, std::memory_order_release);
+    return {slot, s.generation.load(std::memory_order_relaxed)};
 }
 
 std::shared_ptr<void> context::get_object(std::string_view name) const noexcept {
     auto objects = m_impl->m_objects.unique_lock();
-    auto it = objects->find(name);
-    if (it == objects->end()) return {};
-    return it->second;
+    auto it = objects->by_name.find(name);
+    if (it == objects->by_name.end()) return {};
+    return it->second.obj;
+}
+
+context::key<void> context::find_object_slot(std::string_view name) const noexcept {
+    auto objects = m_impl->m_objects.unique_lock();
+    auto it = objects->by_name.find(name);
+    if (it == objects->by_name.end()) return {};
+    const auto slot = it->second.slot;
+    return {slot, m_impl->slot_ref(slot).generation.load(std::memory_order_relaxed)};
+}
+
+void* context::get_object_slot(key<void> k) const noexcept {
+    if (k.slot == invalid_slot) return nullptr;
+    auto& s = m_impl->slot_ref(k.slot);
+    auto ptr = s.ptr.load(std::memory_order_acquire);
+    // loaded after the pointer: a pointer stored after the slot was reused comes with a new generation
+    if (s.generation.load(std::memory_order_relaxed) != k.generation) return nullptr;
+    return ptr;
 }
 
 std::shared_ptr<void> context::detach_object(std::string_view name) noexcept {
     auto objects = m_impl->m_objects.unique_lock();
-    auto f = objects->find(name);
-    if (f == objects->end()) return {};
+    auto f = objects->by_name.find(name);
+    if (f == objects->by_name.end()) return {};
+
+    // stale keys will get null from now on, even if the slot is reused
+    auto& s = m_impl->slot_ref(f->second.slot);
+    s.ptr.store(nullptr, std::memory_order_release);
+    s.generation.fetch_add(1, std::memory_order_release);
+    objects->free_slots.push_back(f->second.slot);
 
-    auto ret = f->second;
-    objects->erase(f);
+    auto ret = std::move(f->second.obj);
+    objects->by_name.erase(f);
     return ret;
 }
 
 timer::~timer() = default; // export vtable
 
+// for the executors of a context the asio timer is bound to the plain io_context executor and the completions
+// are sent to our executor, thus we avoid asio's type-erased executors, which allocate on every wait when they
+// hold a strand. Other executors get a timer on their asio executor, whose lateness is not recorded (lateness is null)
+template <typename AsioExecutor>
 struct timer_impl final : public timer {
 public:
-    asio::steady_timer m_timer;
+    using asio_timer = asio::basic_waitable_timer<clock_type, asio::wait_traits<clock_type>, AsioExecutor>;
+    asio_timer m_timer;
+    timer_lateness_recorder* m_lateness;
+    memory_account_ptr m_account;
 
-    explicit timer_impl(executor_ptr strand)
+    timer_impl(executor_ptr strand, AsioExecutor aex, timer_lateness_recorder* lateness)
         : timer(strand)
-        , m_timer(strand->as_asio_executor())
-    {}
+        , m_timer(std::move(aex))
+        , m_lateness(lateness)
+        , m_account(strand->get_memory_account())
+    {
+        if (m_account) {
+            m_account->charge(memory_account::category::timers, sizeof(timer_impl));
+        }
+    }
+
+    ~timer_impl() {
+        if (m_account) {
+            m_account->discharge(memory_account::category::timers, sizeof(timer_impl));
+        }
+    }
 
     virtual size_t expire_after(duration timeFromNow) override {
         return m_timer.expires_after(timeFromNow);
@@ -250,12 +733,63 @@ public:
     }
 
     virtual void add_wait_cb(wait_func cb) override {
-        m_timer.async_wait(std::move(cb));
+        // a successful completion means that the expiry hasn't changed since the wait was added
+        // (changing it cancels pending waits), so we capture it here and don't touch the timer in the handler,
+        // which may run after it's destroyed
+        auto handler = [cb = std::move(cb), expiry = m_timer.expiry(), label = m_label, lateness = m_lateness]
+        (const boost::system::error_code& ec) mutable {
+            if (!ec && lateness) {
+                lateness->record(clock_type::now() - expiry, expiry, label);
+            }
+            cb(ec);
+        };
+        if (m_account) [[unlikely]] {
+            m_timer.async_wait(asio::bind_executor(m_executor->as_asio_executor(),
+                impl::accounted_handler{std::move(handler), m_account, memory_account::category::timers}));
+            return;
+        }
+        m_timer.async_wait(asio::bind_executor(m_executor->as_asio_executor(), with_handler_allocator{std::move(handler)}));
+    }
+
+    static void complete_node(void* n) {
+        auto& node = *static_cast<wait_node*>(n);
+        node.complete(node, node.result);
+    }
+
+    virtual void add_wait_node(wait_node& node) override {
+        // as above, but the handler runs on any thread of the context, so the lateness is recorded there
+        // and the node is completed on our executor with post_call: no allocations after the handler
+        // allocator has cached the operation
+        auto handler = [&node, ex = m_executor, expiry = m_timer.expiry(), label = m_label, lateness = m_lateness]
+        (const boost::system::error_code& ec) {
+            if (!ec && lateness) {
+                lateness->record(clock_type::now() - expiry, expiry, label);
+            }
+            node.result = ec;
+            ex->post_call(complete_node, &node);
+        };
+        if (m_account) [[unlikely]] {
+            m_timer.async_wait(impl::accounted_handler{std::move(handler), m_account, memory_account::category::timers});
+            return;
+        }
+        m_timer.async_wait(with_handler_allocator{std::move(handler)});
     }
 };
 
+timer_ptr executor::make_timer() {
+    return {};
+}
+
 timer_ptr timer::create(const executor_ptr& ex) {
-    return std::make_unique<timer_impl>(ex);
+    if (auto t = ex->make_timer()) return t;
+
+    auto aex = ex->as_asio_executor();
+    auto& actx = asio::query(aex, asio::execution::context);
+    if (asio::has_service<context_timer_service>(actx)) {
+        auto& s = asio::use_service<context_timer_service>(actx);
+        return std::make_unique<timer_impl<asio::io_context::executor_type>>(ex, s.m_ioc->get_executor(), &s.m_lateness);
+    }
+    return std::make_unique<timer_impl<asio::any_io_executor>>(ex, std::move(aex), nullptr);
 }
 
 } // namespace xeq
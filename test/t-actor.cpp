@@ -0,0 +1,131 @@
+#include <xeq/actor.hpp>
+#include <xeq/context.hpp>
+#include <xeq/thread_runner.hpp>
+#include <doctest/doctest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace xeq;
+
+TEST_CASE("batches") {
+    context ctx;
+    auto strand = ctx.make_strand();
+
+    std::vector<int> log;
+    auto a = make_actor<int>(strand, [&](int i) {
+        CHECK(strand->running_in_this_thread());
+        log.push_back(i);
+    }, 3);
+
+    for (int i = 0; i < 10; ++i) {
+        a->send(i);
+    }
+    // the actor was scheduled with the first send, so this runs after its first batch
+    strand->post([&] { log.push_back(-1); });
+
+    ctx.run();
+    CHECK(log == std::vector<int>{0, 1, 2, -1, 3, 4, 5, 6, 7, 8, 9});
+
+    // and again after it's idle
+    a->send(10);
+    ctx.restart();
+    ctx.run();
+    CHECK(log.back() == 10);
+}
+
+TEST_CASE("lifetime") {
+    context ctx;
+    std::string got;
+    std::weak_ptr<actor<std::unique_ptr<std::string>>> weak;
+    {
+        auto a = make_actor<std::unique_ptr<std::string>>(ctx.make_strand(), [&](std::unique_ptr<std::string> s) {
+            got += *s;
+        });
+        weak = a;
+        a->send(std::make_unique<std::string>("a"));
+        a->send(std::make_unique<std::string>("b"));
+    }
+    CHECK_FALSE(weak.expired()); // kept alive while scheduled
+    ctx.run();
+    CHECK(got == "ab");
+    CHECK(weak.expired());
+}
+
+namespace {
+// a run which handles a single message and drops the keepalive without yielding
+// this leaves the actor with no run pending but with messages in its pending list (and in its inbox after more sends)
+struct stalled_actor : public actor<std::shared_ptr<int>> {
+    explicit stalled_actor(strand_ptr strand)
+        : actor(std::move(strand), 1, run)
+    {}
+
+    static void run(void* p) {
+        auto& self = *static_cast<stalled_actor*>(p);
+        auto keepalive = self.take_keepalive();
+        delete self.next_message();
+    }
+};
+}
+
+TEST_CASE("pending messages are destroyed with the actor") {
+    context ctx;
+    auto p = std::make_shared<int>(5);
+    auto a = std::make_shared<stalled_actor>(ctx.make_strand());
+    std::weak_ptr<stalled_actor> weak = a;
+    for (int i = 0; i < 3; ++i) {
+        a->send(p);
+    }
+    CHECK(p.use_count() == 4);
+    ctx.run();
+    CHECK(p.use_count() == 3); // two left in the pending list
+
+    // not scheduled anew, as the actor never yielded
+    a->send(p);
+    CHECK(p.use_count() == 4);
+
+    a.reset();
+    CHECK(weak.expired());
+    CHECK(p.use_count() == 1);
+}
+
+TEST_CASE("fan-in") {
+    context ctx;
+    auto wg = ctx.make_work_guard();
+    thread_runner runner;
+    runner.start(ctx, 2);
+
+    constexpr int num_senders = 4;
+    constexpr int per_sender = 20'000;
+
+    struct msg {
+        int sender;
+        int i;
+    };
+    std::vector<int> last(num_senders, -1);
+    int total = 0;
+    bool in_order = true;
+    std::atomic_bool done = false;
+    auto a = make_actor<msg>(ctx.make_strand(), [&](msg m) {
+        in_order = in_order && m.i == last[m.sender] + 1;
+        last[m.sender] = m.i;
+        if (++total == num_senders * per_sender) done = true;
+    }, 16);
+
+    std::vector<std::thread> senders;
+    for (int s = 0; s < num_senders; ++s) {
+        senders.emplace_back([&, s] {
+            for (int i = 0; i < per_sender; ++i) {
+                a->send(msg{s, i});
+            }
+        });
+    }
+    for (auto& t : senders) t.join();
+    while (!done) std::this_thread::yield();
+
+    wg.reset();
+    runner.join();
+    CHECK(in_order);
+    CHECK(total == num_senders * per_sender);
+}
@@ -0,0 +1,205 @@
+#include <xeq/context.hpp>
+#include <xeq/executor.hpp>
+#include <xeq/thread_runner.hpp>
+#include <xeq/timer.hpp>
+#include <doctest/doctest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("objects") {
+    xeq::context ctx;
+
+    auto s = std::make_shared<std::string>("hello");
+    ctx.attach_object("str", s);
+    CHECK(ctx.get_object("str") == s);
+    CHECK_FALSE(ctx.get_object("nope"));
+    CHECK_THROWS_WITH(ctx.attach_object("str", std::make_shared<int>(5)),
+        "xeq::context::attach_object: object with name 'str' already exists");
+
+    CHECK(ctx.detach_object("str") == s);
+    CHECK_FALSE(ctx.get_object("str"));
+    CHECK_FALSE(ctx.detach_object("str"));
+}
+
+TEST_CASE("object keys") {
+    xeq::context ctx;
+
+    xeq::context::key<int> none;
+    CHECK_FALSE(none);
+    CHECK_FALSE(ctx.get(none));
+
+    auto ik = ctx.attach_object("int", std::make_shared<int>(42));
+    auto sk = ctx.attach_object("str", std::make_shared<std::string>("xx"));
+    REQUIRE(ik);
+    REQUIRE(sk);
+    CHECK(ik.slot != sk.slot);
+    CHECK(*ctx.get(ik) == 42);
+    CHECK(*ctx.get(sk) == "xx");
+
+    auto fk = ctx.find_key<std::string>("str");
+    CHECK(fk.slot == sk.slot);
+    CHECK(ctx.get(fk) == ctx.get(sk));
+    CHECK_FALSE(ctx.find_key<int>("nope"));
+
+    // untyped attach also gets a slot
+    ctx.attach_object("void", std::shared_ptr<void>(std::make_shared<double>(3.5)));
+    auto dk = ctx.find_key<double>("void");
+    REQUIRE(dk);
+    CHECK(*ctx.get(dk) == 3.5);
+
+    auto obj = ctx.detach_object("int");
+    CHECK(obj);
+    CHECK_FALSE(ctx.get(ik));
+
+    // slots are reused, but stale keys still get null
+    auto ik2 = ctx.attach_object("int", std::make_shared<int>(7));
+    CHECK(ik2.slot == ik.slot);
+    CHECK(ik2.generation != ik.generation);
+    CHECK_FALSE(ctx.get(ik));
+    CHECK(*ctx.get(ik2) == 7);
+    CHECK(ctx.get(ctx.find_key<int>("int")) == ctx.get(ik2));
+
+    // attach/detach churn doesn't run out of slots
+    for (int i = 0; i < 100'000; ++i) {
+        auto k = ctx.attach_object("churn", std::make_shared<int>(i));
+        CHECK(k.slot != ik2.slot);
+        ctx.detach_object("churn");
+        CHECK_FALSE(ctx.get(k));
+    }
+
+    // many objects span multiple slot blocks
+    std::vector<xeq::context::key<int>> keys;
+    for (int i = 0; i < 1000; ++i) {
+        keys.push_back(ctx.attach_object("i" + std::to_string(i), std::make_shared<int>(i)));
+    }
+    for (int i = 0; i < 1000; ++i) {
+        CHECK(*ctx.get(keys[i]) == i);
+    }
+}
+
+TEST_CASE("reset") {
+    xeq::context ctx;
+    auto obj = std::make_shared<int>(1);
+    auto k = ctx.attach_object("obj", obj);
+    CHECK(ctx.reset());
+    CHECK_FALSE(ctx.get(k));
+    CHECK_FALSE(ctx.get_object("obj"));
+    CHECK(obj.use_count() == 1);
+
+    ctx.stop();
+    CHECK_FALSE(ctx.reset()); // may have pending work
+    CHECK(ctx.reset());
+}
+
+TEST_CASE("backend") {
+    std::string_view backend = xeq::context::backend_name();
+    CHECK_FALSE(backend.empty());
+}
+
+TEST_CASE("run_spin") {
+    using namespace std::chrono_literals;
+
+    {
+        // runs out of work like run
+        xeq::context ctx;
+        int n = 0;
+        for (int i = 0; i < 3; ++i) {
+            ctx.get_executor()->post([&] { ++n; });
+        }
+        CHECK(ctx.run_spin(1ms) == 3);
+        CHECK(n == 3);
+    }
+
+    auto ping = [](xeq::context& ctx, int count, std::chrono::microseconds gap) {
+        std::atomic_int n = 0;
+        for (int i = 0; i < count; ++i) {
+            std::this_thread::sleep_for(gap);
+            ctx.get_executor()->post([&] { ++n; });
+            while (n.load() == i) std::this_thread::yield();
+        }
+    };
+
+    {
+        // a huge budget: never parks after the first handler
+        // (a post which arrives before the runner starts spinning is picked up without a spin hit,
+        // so only check that there were some)
+        xeq::context ctx;
+        auto wg = ctx.make_work_guard();
+        xeq::thread_runner runner;
+        runner.start_spin(ctx, 1, 10s);
+        ping(ctx, 10, 1000us);
+        wg.reset();
+        runner.join();
+        auto stats = ctx.get_spin_stats();
+        CHECK(stats.spin_hits > 0);
+        CHECK(stats.parks <= 1);
+    }
+
+    {
+        // no budget: parks every time
+        xeq::context ctx;
+        auto wg = ctx.make_work_guard();
+        xeq::thread_runner runner;
+        runner.start_spin(ctx, 1, 0ns);
+        ping(ctx, 10, 1000us);
+        wg.reset();
+        runner.join();
+        auto stats = ctx.get_spin_stats();
+        CHECK(stats.spin_hits == 0);
+        CHECK(stats.parks > 0);
+    }
+}
+
+TEST_CASE("timer stats") {
+    using namespace std::chrono_literals;
+    xeq::context ctx;
+
+    auto empty = ctx.get_timer_stats();
+    CHECK(empty.count == 0);
+    CHECK(empty.num_worst == 0);
+    CHECK(empty.percentile(0.99) == 0ns);
+
+    auto slow = xeq::timer::create(ctx.get_executor());
+    slow->set_label("slow");
+    slow->expire_after(1ms);
+    slow->add_wait_cb([](const xeq::error_code&) {});
+
+    auto cancelled = xeq::timer::create(ctx.get_executor());
+    cancelled->expire_after(1ms);
+    cancelled->add_wait_cb([](const xeq::error_code&) {});
+    cancelled->cancel();
+
+    // block the loop, so that the timer fires late
+    ctx.get_executor()->post([] {
+        std::this_thread::sleep_for(20ms);
+    });
+    ctx.run();
+    ctx.restart();
+
+    auto quick = xeq::timer::create(ctx.get_executor());
+    quick->expire_after(0ms);
+    quick->add_wait_cb([](const xeq::error_code&) {});
+    ctx.run();
+    ctx.restart();
+
+    auto stats = ctx.get_timer_stats();
+    CHECK(stats.count == 2);
+    uint64_t sum = 0;
+    for (auto b : stats.buckets) sum += b;
+    CHECK(sum == 2);
+    CHECK(stats.max >= 15ms);
+    CHECK(stats.mean() <= stats.max);
+    CHECK(stats.percentile(1) >= stats.max);
+    REQUIRE(stats.num_worst == 2);
+    CHECK(stats.worst[0].lateness == stats.max);
+    CHECK(std::string_view(stats.worst[0].label) == "slow");
+    CHECK(stats.worst[1].label == nullptr);
+    CHECK(stats.worst[1].lateness <= stats.worst[0].lateness);
+
+    ctx.reset_timer_stats();
+    stats = ctx.get_timer_stats();
+    CHECK(stats.count == 0);
+    CHECK(stats.num_worst == 0);
+}
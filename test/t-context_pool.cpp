@@ -0,0 +1,125 @@
+#include <xeq/context_pool.hpp>
+#include <xeq/context.hpp>
+#include <xeq/timer_wobj.hpp>
+#include <doctest/doctest.h>
+#include <atomic>
+#include <latch>
+#include <vector>
+
+using namespace xeq;
+
+TEST_CASE("shards") {
+    auto pool = context_pool::create({.num_shards = 3, .pin_threads = false});
+    REQUIRE(pool->num_shards() == 3);
+    CHECK(pool->current_shard() == context_pool::no_shard);
+    CHECK_FALSE(pool->get_executor()->running_in_this_thread());
+
+    for (size_t i = 0; i < 3; ++i) {
+        auto& ex = pool->shard_executor(i);
+        CHECK(ex->is_strand());
+        CHECK(ex->make_strand() == ex);
+        CHECK(ex->get_super_executor() == pool->shard(i).get_executor());
+    }
+
+    // a timer is bound to a single shard
+    auto t = timer::create(pool->get_executor());
+    CHECK(t->get_executor()->is_strand());
+    CHECK(timer::create(pool->shard_executor(1)));
+
+    // same key, same shard
+    CHECK(pool->executor_for(42) == pool->executor_for(42));
+
+    std::atomic_int per_shard[3] = {};
+    std::atomic_int wrong_thread = 0;
+    std::latch done(300);
+    for (int i = 0; i < 300; ++i) {
+        pool->post([&] {
+            auto s = pool->current_shard();
+            if (!pool->shard_executor(s)->running_in_this_thread()) ++wrong_thread;
+            if (!pool->get_executor()->running_in_this_thread()) ++wrong_thread;
+            ++per_shard[s];
+            done.count_down();
+        });
+    }
+    done.wait();
+    CHECK(wrong_thread == 0);
+
+    // round-robin
+    CHECK(per_shard[0] == 100);
+    CHECK(per_shard[1] == 100);
+    CHECK(per_shard[2] == 100);
+}
+
+TEST_CASE("keyed posts") {
+    auto pool = context_pool::create({.num_shards = 4, .pin_threads = false, .unsafe_io = true});
+
+    std::vector<size_t> shards(20, context_pool::no_shard);
+    std::latch done(20);
+    for (uint64_t key = 0; key < 20; ++key) {
+        pool->post(key, [&, key] {
+            shards[key] = pool->current_shard();
+            done.count_down();
+        });
+    }
+    done.wait();
+
+    for (uint64_t key = 0; key < 20; ++key) {
+        CHECK(pool->shard_executor(shards[key]) == pool->executor_for(key));
+    }
+}
+
+namespace {
+coro<void> hop(context_pool& pool, int n, std::atomic_int& moved, std::latch& done) {
+    auto ex = co_await this_coro::executor{};
+    const auto shard = pool.current_shard();
+    timer_wobj wobj(ex);
+    for (int i = 0; i < n; ++i) {
+        co_await wobj.wait(timeout::after_ms(1));
+        if (pool.current_shard() != shard) ++moved;
+    }
+    done.count_down();
+}
+}
+
+TEST_CASE("co_spawn") {
+    auto pool = context_pool::create({.num_shards = 2, .pin_threads = false});
+
+    std::atomic_int moved = 0;
+    std::latch done(6);
+    for (int i = 0; i < 4; ++i) {
+        co_spawn(*pool, hop(*pool, 5, moved, done));
+    }
+    co_spawn(*pool, 7, hop(*pool, 5, moved, done));
+    co_spawn(*pool, 8, hop(*pool, 5, moved, done));
+    done.wait();
+
+    // coroutines stay on their shard
+    CHECK(moved == 0);
+}
+
+TEST_CASE("pool timer") {
+    auto pool = context_pool::create({.num_shards = 2, .pin_threads = false});
+
+    std::atomic_bool ok = false;
+    std::latch done(1);
+    auto t = timer::create(pool->get_executor());
+    t->expire_after(std::chrono::milliseconds(1));
+    t->add_wait_cb([&](const error_code& ec) {
+        ok = !ec && pool->current_shard() != context_pool::no_shard;
+        done.count_down();
+    });
+    done.wait();
+    CHECK(ok);
+}
+
+TEST_CASE("executor outlives the pool") {
+    auto pool = context_pool::create({.num_shards = 2, .pin_threads = false});
+    auto ex = pool->get_executor();
+    pool.reset();
+
+    bool called = false;
+    ex->post([&] { called = true; });
+    CHECK_FALSE(called);
+    CHECK_FALSE(ex->running_in_this_thread());
+    CHECK_THROWS_WITH(timer::create(ex), "xeq::context_pool: the pool has been destroyed");
+}
@@ -2,6 +2,10 @@
 #include <xeq/co_spawn.hpp>
 #include <xeq/co_execute.hpp>
 #include <xeq/context.hpp>
+#include <xeq/executor.hpp>
+#include <xeq/executor_local.hpp>
+#include <xeq/executor_bounds.hpp>
+#include <xeq/memory_account.hpp>
 #include <doctest/doctest.h>
 
 using namespace xeq;
@@ -44,3 +48,47 @@ TEST_CASE("execute") {
     CHECK(co_execute(maybe_throw(6, false)) == 6);
     CHECK_THROWS_WITH(co_execute(maybe_throw(3, true)), "ex");
 }
+
+coro<executor*> current_executor() {
+    auto& ex = co_await this_coro::executor{};
+    co_return ex.get();
+}
+
+coro<int> nested_execute() {
+    // the outer call is running, so this gets a fresh context
+    auto inner = co_execute(current_executor());
+    auto outer = co_await current_executor();
+    CHECK(inner != outer);
+    co_return co_execute(five()) + 1;
+}
+
+TEST_CASE("execute context reuse") {
+    auto e1 = co_execute(current_executor());
+    CHECK_THROWS(co_execute(maybe_throw(1, true)));
+    auto e2 = co_execute(current_executor());
+    CHECK(e1 == e2);
+    CHECK(co_execute(nested_execute()) == 6);
+    CHECK(co_execute(current_executor()) == e1);
+}
+
+namespace {
+const executor_local<int> exec_local_int;
+
+coro<void> leave_state() {
+    auto& ex = co_await this_coro::executor{};
+    exec_local_int.get(*ex) = 5;
+    ex->set_memory_account(std::make_shared<memory_account>());
+    ex->set_bounds(executor_bounds::create({}));
+}
+
+coro<bool> state_is_clean() {
+    auto& ex = co_await this_coro::executor{};
+    co_return !exec_local_int.find(*ex) && !ex->get_memory_account() && !ex->get_bounds();
+}
+}
+
+TEST_CASE("execute context reset") {
+    // the reused context doesn't carry state from one call to the next
+    co_execute(leave_state());
+    CHECK(co_execute(state_is_clean()));
+}
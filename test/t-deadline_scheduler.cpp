@@ -0,0 +1,97 @@
+#include <xeq/deadline_scheduler.hpp>
+#include <xeq/context.hpp>
+#include <xeq/co_spawn.hpp>
+#include <doctest/doctest.h>
+#include <string>
+
+using namespace xeq;
+using namespace std::chrono_literals;
+
+coro<coro_deadline> get_deadline() {
+    co_return co_await this_coro::deadline{};
+}
+
+coro<void> task(std::string& log, char id, coro_deadline expected) {
+    // not awaiting in CHECK directly, as gcc 12 miscompiles co_await in an if condition with some awaitables
+    auto d = co_await this_coro::deadline{};
+    CHECK(d == expected);
+    // inherited
+    auto nested = co_await get_deadline();
+    CHECK(nested == expected);
+    log += id;
+}
+
+TEST_CASE("edf order") {
+    context ctx;
+    auto ds = deadline_scheduler::create(ctx);
+
+    const auto now = coro_deadline::clock::now();
+    std::string log;
+    co_spawn(ds, now + 3s, task(log, 'c', now + 3s));
+    co_spawn(ds, now + 1s, task(log, 'a', now + 1s));
+    ds->post(no_deadline, [&] { log += 'z'; });
+    co_spawn(ds, now + 2s, task(log, 'b', now + 2s));
+    co_spawn(ds, now + 1s, task(log, 'A', now + 1s)); // FIFO for equal deadlines
+    ctx.run();
+
+    CHECK(log == "aAbcz");
+
+    auto stats = ds->get_stats();
+    CHECK(stats.executed == 5);
+    CHECK(stats.shed == 0);
+    CHECK(stats.started_late == 0);
+    CHECK(stats.queued == 0);
+}
+
+TEST_CASE("default deadline") {
+    context ctx;
+    std::string log;
+    co_spawn(ctx, task(log, 'x', no_deadline));
+    ctx.run();
+    CHECK(log == "x");
+}
+
+struct flag_on_destroy {
+    bool* flag;
+    flag_on_destroy(bool* f) : flag(f) {}
+    flag_on_destroy(flag_on_destroy&& other) noexcept : flag(std::exchange(other.flag, nullptr)) {}
+    ~flag_on_destroy() { if (flag) *flag = true; }
+};
+
+coro<void> sheddable(std::string& log, char id, flag_on_destroy) {
+    log += id;
+    co_return;
+}
+
+TEST_CASE("shed") {
+    context ctx;
+    int shed_cbs = 0;
+    auto ds = deadline_scheduler::create(ctx, {true, [&](coro_deadline) { ++shed_cbs; }});
+
+    const auto now = coro_deadline::clock::now();
+    std::string log;
+    bool destroyed_expired = false, destroyed_ok = false;
+    co_spawn(ds, now - 1ms, sheddable(log, 'x', &destroyed_expired));
+    co_spawn(ds, now + 1h, sheddable(log, 'o', &destroyed_ok));
+    ctx.run();
+
+    CHECK(log == "o");
+    CHECK(destroyed_expired);
+    CHECK(destroyed_ok);
+    CHECK(shed_cbs == 1);
+
+    auto stats = ds->get_stats();
+    CHECK(stats.shed == 1);
+    CHECK(stats.executed == 1);
+}
+
+TEST_CASE("late") {
+    context ctx;
+    auto ds = deadline_scheduler::create(ctx);
+
+    std::string log;
+    co_spawn(ds, coro_deadline::clock::now() - 1ms, sheddable(log, 'l', nullptr));
+    ctx.run();
+    CHECK(log == "l");
+    CHECK(ds->get_stats().started_late == 1);
+}
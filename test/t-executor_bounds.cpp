@@ -0,0 +1,151 @@
+#include <xeq/executor_bounds.hpp>
+#include <xeq/context.hpp>
+#include <xeq/co_spawn.hpp>
+#include <xeq/executor.hpp>
+#include <xeq/priority_scheduler.hpp>
+#include <doctest/doctest.h>
+#include <vector>
+
+using namespace xeq;
+
+TEST_CASE("config") {
+    CHECK_THROWS_WITH(executor_bounds::create({.capacity = 0}), "xeq::executor_bounds: capacity must be positive");
+    CHECK_THROWS_WITH(executor_bounds::create({.high_watermark = 4, .on_high = [](size_t) {}}),
+        "xeq::executor_bounds: watermarks need both callbacks");
+    CHECK_THROWS_WITH(executor_bounds::create({.high_watermark = 4, .on_low = [](size_t) {}}),
+        "xeq::executor_bounds: watermarks need both callbacks");
+    CHECK_THROWS_WITH(executor_bounds::create({.high_watermark = 4, .low_watermark = 4,
+        .on_high = [](size_t) {}, .on_low = [](size_t) {}}),
+        "xeq::executor_bounds: low watermark must be below the high one");
+    CHECK(executor_bounds::create({.high_watermark = 4, .low_watermark = 3, .on_high = [](size_t) {}, .on_low = [](size_t) {}}));
+    CHECK(executor_bounds::create({.capacity = 1}));
+}
+
+TEST_CASE("try_post") {
+    context ctx;
+    auto& ex = ctx.get_executor();
+
+    int ran = 0;
+    CHECK(ex->try_post([&] { ++ran; })); // unbounded
+
+    auto b = executor_bounds::create({.capacity = 3});
+    ex->set_bounds(b);
+    CHECK(b->depth() == 0);
+
+    CHECK(ex->try_post([&] { ++ran; }));
+    CHECK(ex->try_post([&] { ++ran; }));
+    CHECK(ex->try_post([&] { ++ran; }));
+    CHECK(b->depth() == 3);
+    CHECK_FALSE(b->has_room());
+    CHECK_FALSE(ex->try_post([&] { ++ran; }));
+
+    ex->post([&] { ++ran; }); // post always posts
+    CHECK(b->depth() == 4);
+
+    ctx.run();
+    CHECK(ran == 5);
+    CHECK(b->depth() == 0);
+
+    CHECK(ex->try_post([&] { ++ran; }));
+    ctx.restart();
+    ctx.run();
+    CHECK(ran == 6);
+}
+
+TEST_CASE("queued executor") {
+    context ctx;
+    auto ps = priority_scheduler::create(ctx);
+    auto& ex = ps->get_executor(1);
+
+    auto b = executor_bounds::create({.capacity = 2});
+    ex->set_bounds(b);
+
+    int ran = 0;
+    CHECK(ex->try_post([&] { ++ran; }));
+    CHECK(ex->try_post([&] { ++ran; }));
+    CHECK(b->depth() == 2);
+    CHECK_FALSE(ex->try_post([&] { ++ran; }));
+
+    ctx.run();
+    CHECK(ran == 2);
+    CHECK(b->depth() == 0);
+}
+
+TEST_CASE("watermarks") {
+    context ctx;
+    auto strand = ctx.make_strand();
+
+    std::vector<size_t> highs, lows;
+    auto b = executor_bounds::create({
+        .capacity = 100,
+        .high_watermark = 4,
+        .low_watermark = 1,
+        .on_high = [&](size_t d) { highs.push_back(d); },
+        .on_low = [&](size_t d) { lows.push_back(d); },
+    });
+    strand->set_bounds(b);
+
+    for (int i = 0; i < 6; ++i) {
+        strand->post([] {});
+    }
+    CHECK(highs == std::vector<size_t>{4}); // once
+    CHECK(lows.empty());
+
+    ctx.run();
+    CHECK(highs.size() == 1);
+    CHECK(lows == std::vector<size_t>{1});
+    CHECK(b->depth() == 0);
+
+    // and again
+    for (int i = 0; i < 4; ++i) {
+        strand->post([] {});
+    }
+    CHECK(highs.size() == 2);
+    ctx.restart();
+    ctx.run();
+    CHECK(lows.size() == 2);
+}
+
+TEST_CASE("destroyed handlers") {
+    auto b = executor_bounds::create({.capacity = 10});
+    {
+        context ctx;
+        ctx.get_executor()->set_bounds(b);
+        ctx.get_executor()->post([] {});
+        ctx.get_executor()->post([] {});
+        CHECK(b->depth() == 2);
+    }
+    CHECK(b->depth() == 0);
+}
+
+namespace {
+coro<void> producer(strand_ptr target, int n, std::vector<int>& out, size_t& max_depth) {
+    for (int i = 0; i < n; ++i) {
+        // gcc 12 destroys temporaries in a co_await expression twice, so the lambda (with a shared_ptr) must
+        // not be one: make a named awaitable
+        auto aw = post_or_wait(target, [&out, &max_depth, i, b = target->get_bounds()] {
+            max_depth = std::max(max_depth, b->depth() + 1);
+            out.push_back(i);
+        });
+        co_await aw;
+    }
+}
+}
+
+TEST_CASE("post_or_wait") {
+    context ctx;
+    auto target = ctx.make_strand();
+    target->set_bounds(executor_bounds::create({.capacity = 2}));
+
+    std::vector<int> out;
+    size_t max_depth = 0;
+    co_spawn(ctx, producer(target, 20, out, max_depth));
+    ctx.run();
+
+    REQUIRE(out.size() == 20);
+    for (int i = 0; i < 20; ++i) {
+        CHECK(out[i] == i);
+    }
+    CHECK(max_depth <= 2);
+    CHECK(target->get_bounds()->depth() == 0);
+}
@@ -0,0 +1,125 @@
+#include <xeq/executor_local.hpp>
+#include <xeq/context.hpp>
+#include <xeq/co_spawn.hpp>
+#include <xeq/thread_runner.hpp>
+#include <doctest/doctest.h>
+#include <atomic>
+#include <latch>
+#include <string>
+#include <vector>
+
+using namespace xeq;
+
+namespace {
+int num_destroyed = 0;
+struct tracked {
+    int value = 0;
+    tracked() = default;
+    explicit tracked(int v) : value(v) {}
+    ~tracked() { ++num_destroyed; }
+};
+}
+
+TEST_CASE("slots") {
+    executor_local<std::string> skey;
+    executor_local<tracked> tkey;
+    CHECK(skey.slot() != tkey.slot());
+
+    num_destroyed = 0;
+    {
+        context ctx;
+        auto a = ctx.make_strand();
+        auto b = ctx.make_strand();
+
+        CHECK_FALSE(skey.find(*a));
+        auto& s = skey.get(*a);
+        CHECK(s.empty());
+        s = "a";
+        CHECK(&skey.get(*a) == &s);
+        CHECK(skey.find(*a) == &s);
+
+        // each executor has its own values
+        CHECK_FALSE(skey.find(*b));
+        skey.get(*b) = "b";
+        CHECK(skey.get(*a) == "a");
+        CHECK(skey.get(*b) == "b");
+
+        CHECK(tkey.emplace(*a, 5).value == 5);
+        CHECK(tkey.get(*a).value == 5);
+        tkey.emplace(*a, 6);
+        CHECK(num_destroyed == 1);
+        CHECK(tkey.get(*a).value == 6);
+
+        tkey.reset(*a);
+        CHECK(num_destroyed == 2);
+        CHECK_FALSE(tkey.find(*a));
+        tkey.reset(*b); // noop
+
+        tkey.get(*b);
+        tkey.get(*ctx.get_executor());
+    }
+    // destroyed with the executors
+    CHECK(num_destroyed == 4);
+}
+
+namespace {
+executor_local<std::vector<int>> g_buf;
+
+coro<void> add(int n) {
+    auto& buf = co_await this_coro::local{g_buf};
+    buf.push_back(n);
+}
+
+coro<void> worker(int n) {
+    for (int i = 0; i < n; ++i) {
+        co_await add(i);
+    }
+}
+}
+
+TEST_CASE("coro") {
+    context ctx;
+    auto a = ctx.make_strand();
+    auto b = ctx.make_strand();
+    co_spawn(a, worker(3));
+    co_spawn(b, worker(2));
+    co_spawn(a, worker(1));
+    ctx.run();
+
+    CHECK(g_buf.get(*a) == std::vector<int>{0, 1, 2, 0});
+    CHECK(g_buf.get(*b) == std::vector<int>{0, 1});
+}
+
+TEST_CASE("concurrent keys") {
+    // more keys than a storage block, each created by a handler on a multi-threaded executor
+    // while the others look up all of them
+    constexpr int num_keys = 100;
+    static executor_local<int> keys[num_keys];
+
+    context ctx;
+    auto& ex = ctx.get_executor();
+    auto wg = ctx.make_work_guard();
+    thread_runner runner;
+    runner.start(ctx, 4);
+
+    std::atomic_int wrong = 0;
+    std::latch done(num_keys);
+    for (int i = 0; i < num_keys; ++i) {
+        ex->post([&, i] {
+            keys[i].emplace(*ex, i);
+            for (int j = 0; j < num_keys; ++j) {
+                auto p = keys[j].find(*ex);
+                if (p && *p != j) ++wrong;
+            }
+            done.count_down();
+        });
+    }
+    done.wait();
+    wg.reset();
+    runner.join();
+
+    CHECK(wrong == 0);
+    for (int i = 0; i < num_keys; ++i) {
+        CHECK(keys[i].get(*ex) == i);
+    }
+}
@@ -0,0 +1,101 @@
+#include <xeq/file.hpp>
+#include <xeq/co_for.hpp>
+#include <xeq/co_execute.hpp>
+#include <doctest/doctest.h>
+#include <filesystem>
+#include <vector>
+#include <string>
+
+using namespace xeq;
+
+namespace {
+struct temp_path {
+    std::string path;
+    temp_path(const char* name) {
+        path = (std::filesystem::temp_directory_path() / name).string();
+        std::filesystem::remove(path);
+    }
+    ~temp_path() {
+        std::filesystem::remove(path);
+    }
+};
+
+std::vector<std::byte> make_data(size_t size) {
+    std::vector<std::byte> ret(size);
+    for (size_t i = 0; i < size; ++i) {
+        ret[i] = std::byte(i * 7 + i / 256);
+    }
+    return ret;
+}
+}
+
+coro<void> test_rw(std::string path) {
+    file f(co_await this_coro::executor{}, path, file::read_write | file::create | file::truncate);
+    CHECK(f.is_open());
+    CHECK(f.size() == 0);
+
+    auto data = make_data(10000);
+    co_await write_at(f, 0, data);
+    CHECK(f.size() == 10000);
+
+    std::vector<std::byte> buf(4000);
+    auto n = co_await read_at(f, 9000, buf);
+    CHECK(n == 1000);
+    CHECK(std::equal(buf.begin(), buf.begin() + 1000, data.begin() + 9000));
+
+    // eof is not an error
+    auto eof = co_await f.read_some_at(20000, buf);
+    CHECK(eof == 0);
+
+    // streaming with a reusable buffer
+    std::vector<std::byte> streamed;
+    int chunks = 0;
+    co_for(chunk, read_chunks(f, buf)) {
+        CHECK((*chunk).data() == buf.data()); // no copies
+        streamed.insert(streamed.end(), (*chunk).begin(), (*chunk).end());
+        ++chunks;
+    }
+    CHECK(chunks == 3);
+    CHECK(streamed == data);
+
+    file_stream s(f, 100);
+    auto sn = co_await s.read(std::span(buf).first(50));
+    CHECK(sn == 50);
+    CHECK(s.pos() == 150);
+    CHECK(std::equal(buf.begin(), buf.begin() + 50, data.begin() + 100));
+
+    s.seek(10000);
+    co_await s.write(std::span(data).first(10));
+    CHECK(s.pos() == 10010);
+    CHECK(f.size() == 10010);
+
+    f.close();
+    CHECK_FALSE(f.is_open());
+}
+
+TEST_CASE("read write") {
+    temp_path tp("xeq-t-file-rw");
+    co_execute(test_rw(tp.path));
+}
+
+coro<void> test_errors(std::string path) {
+    file f(co_await this_coro::executor{});
+    CHECK_FALSE(f.is_open());
+    CHECK_THROWS_AS(f.open(path, file::read_only), std::system_error);
+
+    f.open(path, file::write_only | file::create);
+    std::vector<std::byte> buf(10);
+    bool thrown = false;
+    try {
+        co_await f.read_some_at(0, buf);
+    }
+    catch (std::system_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+TEST_CASE("errors") {
+    temp_path tp("xeq-t-file-err");
+    co_execute(test_errors(tp.path));
+}
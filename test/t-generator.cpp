@@ -1,6 +1,11 @@
 #include <xeq/co_for.hpp>
 #include <xeq/co_execute.hpp>
+#include <xeq/buffered_generator.hpp>
+#include <xeq/thread_runner.hpp>
+#include <xeq/simple_wobj.hpp>
+#include <xeq/coro_wobj.hpp>
 #include <doctest/doctest.h>
+#include <atomic>
 #include <span>
 #include <vector>
 #include <string>
@@ -168,3 +173,105 @@ coro<void> return_next_test() {
 TEST_CASE("return next") {
     co_execute(return_next_test());
 }
+
+namespace {
+std::atomic_int g_produced;
+
+generator<std::string, int> counted_strings(int begin, int end, int throw_at = -1) {
+    for (int i = begin; i < end; ++i) {
+        if (i == throw_at) throw std::runtime_error("producer exception");
+        ++g_produced;
+        co_yield std::to_string(i);
+    }
+    co_return end - begin;
+}
+
+coro<void> buffered_test(executor_ptr producer) {
+    g_produced = 0;
+    {
+        auto gen = co_await make_coro_iterator(buffered(counted_strings(0, 100), producer, 4));
+        int i = 0;
+        bool bounded = true;
+        for (; !gen.done(); co_await gen.next()) {
+            CHECK(*gen == std::to_string(i));
+            ++i;
+            // backpressure: one in flight in the consumer, capacity in the buffer
+            if (g_produced > i + 4) bounded = false;
+        }
+        CHECK(bounded);
+        CHECK(i == 100);
+        CHECK(gen.rval() == 100);
+    }
+
+    {
+        int i = 0;
+        CHECK_THROWS_WITH_AS(
+            co_await [&]() -> coro<void> {
+                co_for(x, buffered(counted_strings(0, 10, 7), producer, 3)) {
+                    CHECK(*x == std::to_string(i));
+                    ++i;
+                }
+            }(),
+            "producer exception",
+            std::runtime_error
+        );
+        // all values before the exception are delivered
+        CHECK(i == 7);
+    }
+
+    {
+        // stop early: the producer must stop too
+        g_produced = 0;
+        auto gen = buffered(counted_strings(0, 1000), producer, 2);
+        CHECK(*co_await gen.next() == "0");
+        CHECK(*co_await gen.next() == "1");
+    }
+
+    // never consumed
+    { auto gen = buffered(counted_strings(0, 1000), producer, 2); }
+}
+}
+
+TEST_CASE("buffered") {
+    context ctx;
+    auto wg = ctx.make_work_guard();
+    thread_runner runner(ctx, 2);
+    co_execute(buffered_test(ctx.make_strand()));
+    wg.reset();
+    runner.join();
+    // the producers of the generators which were destroyed early have stopped
+    CHECK(g_produced < 20);
+}
+
+namespace {
+generator<int> gated(simple_wobj& gate) {
+    co_await gate.wait();
+    co_yield 1;
+    co_yield 2;
+}
+
+coro<void> consume_one(generator<int> g, bool& got) {
+    co_await g.next();
+    got = true;
+}
+}
+
+TEST_CASE("buffered consumer destroyed while parked") {
+    context ctx;
+    auto strand = ctx.make_strand();
+    simple_wobj gate(strand);
+
+    bool got = false;
+    auto h = consume_one(buffered(gated(gate), strand, 2), got).take_handle();
+    h.promise().m_executor = strand;
+    strand->post_resume(h);
+    ctx.poll(); // the producer waits on the gate, the consumer is parked on the empty buffer
+
+    h.destroy();
+
+    // the producer must not resume the destroyed consumer
+    gate.notify_one();
+    ctx.restart();
+    ctx.run();
+    CHECK_FALSE(got);
+}
@@ -0,0 +1,140 @@
+#include <xeq/handler_allocator.hpp>
+#include <xeq/context.hpp>
+#include <xeq/executor.hpp>
+#include <xeq/timer.hpp>
+#include <xeq/thread_runner.hpp>
+#include <doctest/doctest.h>
+#include <latch>
+#include <thread>
+
+using namespace xeq;
+
+TEST_CASE("allocator") {
+    handler_allocator<int> a;
+    auto p = a.allocate(4);
+    a.deallocate(p, 4);
+
+    auto s0 = this_thread_handler_memory_stats();
+    auto q = a.allocate(4);
+    CHECK(q == p); // recycled
+    auto s1 = this_thread_handler_memory_stats();
+    CHECK(s1.allocations == s0.allocations + 1);
+    CHECK(s1.cache_hits == s0.cache_hits + 1);
+    CHECK(s1.heap_allocations == s0.heap_allocations);
+    a.deallocate(q, 4);
+
+    // too big to cache
+    handler_allocator<char> ca;
+    auto big = ca.allocate(10000);
+    ca.deallocate(big, 10000);
+    auto s2 = this_thread_handler_memory_stats();
+    CHECK(s2.heap_allocations == s1.heap_allocations + 1);
+    CHECK(s2.heap_deallocations == s1.heap_deallocations + 1);
+
+    CHECK(handler_allocator<int>{} == handler_allocator<char>{});
+}
+
+namespace {
+void post_and_wait(context& ctx, const executor_ptr& ex, const timer_ptr& t, int n) {
+    int count = 0;
+    for (int i = 0; i < n; ++i) {
+        ex->post([&] { ++count; });
+        t->expire_after(std::chrono::milliseconds(0));
+        t->add_wait_cb([&](const error_code&) { ++count; });
+        ctx.run();
+        ctx.restart();
+    }
+    CHECK(count == 2 * n);
+}
+}
+
+TEST_CASE("steady state") {
+    context ctx;
+    auto strand = ctx.make_strand();
+    auto ctx_timer = timer::create(ctx.get_executor());
+    auto strand_timer = timer::create(strand);
+
+    // warm up
+    post_and_wait(ctx, ctx.get_executor(), ctx_timer, 10);
+    post_and_wait(ctx, strand, strand_timer, 10);
+
+    auto s0 = this_thread_handler_memory_stats();
+    post_and_wait(ctx, ctx.get_executor(), ctx_timer, 100);
+    post_and_wait(ctx, strand, strand_timer, 100);
+    auto s1 = this_thread_handler_memory_stats();
+
+    CHECK(s1.allocations > s0.allocations);
+    CHECK(s1.heap_allocations == s0.heap_allocations);
+    CHECK(s1.cache_hits - s0.cache_hits == s1.allocations - s0.allocations);
+}
+
+TEST_CASE("cross-thread") {
+    handler_allocator<int> a;
+
+    // in a new thread, so that the cache is empty
+    std::thread([&] {
+        auto p = a.allocate(4);
+        std::thread([&] {
+            auto s0 = this_thread_handler_memory_stats();
+            a.deallocate(p, 4);
+            auto s1 = this_thread_handler_memory_stats();
+            CHECK(s1.remote_deallocations == s0.remote_deallocations + 1);
+            CHECK(s1.cached_blocks == s0.cached_blocks);
+        }).join();
+
+        auto s0 = this_thread_handler_memory_stats();
+        auto q = a.allocate(4);
+        CHECK(q == p); // returned to this thread
+        auto s1 = this_thread_handler_memory_stats();
+        CHECK(s1.cache_hits == s0.cache_hits + 1);
+        a.deallocate(q, 4);
+    }).join();
+
+    // freed after the thread which allocated it has exited
+    int* orphan = nullptr;
+    std::thread([&] {
+        orphan = a.allocate(4);
+    }).join();
+    auto s0 = this_thread_handler_memory_stats();
+    a.deallocate(orphan, 4);
+    auto s1 = this_thread_handler_memory_stats();
+    CHECK(s1.remote_deallocations == s0.remote_deallocations + 1);
+}
+
+TEST_CASE("cross-thread steady state") {
+    context ctx;
+    auto wg = ctx.make_work_guard();
+    thread_runner runner;
+    runner.start(ctx, 1);
+
+    // the handlers are allocated on this thread and freed on the runner thread
+    // the runner is held until the whole batch is posted, so that every batch needs the same number of blocks
+    auto post_batch = [&](int n) {
+        std::latch held(1), posted(1), done(n);
+        ctx.get_executor()->post([&] {
+            held.count_down();
+            posted.wait();
+        });
+        held.wait();
+        for (int i = 0; i < n; ++i) {
+            ctx.get_executor()->post([&] { done.count_down(); });
+        }
+        posted.count_down();
+        done.wait();
+    };
+
+    // warm up
+    post_batch(100);
+
+    auto s0 = this_thread_handler_memory_stats();
+    for (int i = 0; i < 10; ++i) {
+        post_batch(100);
+    }
+    auto s1 = this_thread_handler_memory_stats();
+
+    CHECK(s1.allocations - s0.allocations == 1010);
+    CHECK(s1.heap_allocations == s0.heap_allocations);
+
+    wg.reset();
+    runner.join();
+}
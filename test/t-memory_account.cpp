@@ -0,0 +1,163 @@
+#include <xeq/memory_account.hpp>
+#include <xeq/context.hpp>
+#include <xeq/co_spawn.hpp>
+#include <xeq/executor.hpp>
+#include <xeq/timer_wobj.hpp>
+#include <xeq/priority_scheduler.hpp>
+#include <doctest/doctest.h>
+
+using namespace xeq;
+using category = memory_account::category;
+
+TEST_CASE("account") {
+    auto parent = std::make_shared<memory_account>();
+    memory_account acct(parent);
+
+    int exceeded = 0;
+    acct.set_soft_limit(100, [&](const memory_account& a) {
+        ++exceeded;
+        CHECK(a.get_snapshot().total.current > 100);
+    });
+
+    acct.charge(category::frames, 60);
+    acct.charge(category::handlers, 30);
+    CHECK(exceeded == 0);
+    acct.charge(category::timers, 20);
+    CHECK(exceeded == 1);
+    acct.charge(category::frames, 20);
+    CHECK(exceeded == 1); // not again until it drops
+
+    auto s = acct.get_snapshot();
+    CHECK(s.total.current == 130);
+    CHECK(s.total.peak == 130);
+    CHECK(s.total.allocations == 4);
+    CHECK(s[category::frames].current == 80);
+    CHECK(s[category::frames].allocations == 2);
+    CHECK(s[category::handlers].current == 30);
+    CHECK(s[category::timers].current == 20);
+
+    acct.discharge(category::frames, 80);
+    acct.discharge(category::handlers, 30);
+    s = acct.get_snapshot();
+    CHECK(s.total.current == 20);
+    CHECK(s.total.peak == 130);
+    CHECK(s[category::frames].peak == 80);
+
+    acct.charge(category::frames, 100);
+    CHECK(exceeded == 2);
+
+    // everything is rolled up into the parent
+    auto ps = parent->get_snapshot();
+    CHECK(ps.total.current == 120);
+    CHECK(ps.total.peak == 130);
+}
+
+namespace {
+coro<int> leaf(int i) {
+    co_return i;
+}
+
+coro<void> work(int& sum, memory_account::snapshot& during) {
+    auto& ex = co_await this_coro::executor{};
+    timer_wobj wobj(ex);
+    sum += co_await leaf(1);
+    for (int i = 0; i < 5; ++i) {
+        ex->post([&sum] { ++sum; });
+    }
+    co_await wobj.wait(timeout::after_ms(1));
+    during = ex->get_memory_account()->get_snapshot();
+    sum += co_await leaf(2);
+}
+}
+
+TEST_CASE("context") {
+    context ctx;
+    CHECK_FALSE(ctx.get_memory_account());
+    auto& acct = ctx.enable_memory_accounting();
+    REQUIRE(acct);
+    CHECK(ctx.get_memory_account() == acct);
+
+    auto strand = ctx.make_strand();
+    CHECK(strand->get_memory_account() == acct);
+
+    int sum = 0;
+    memory_account::snapshot during = {};
+    co_spawn(strand, work(sum, during));
+    ctx.run();
+    CHECK(sum == 8);
+
+    // the timer and the leaf frame are alive while we're waiting
+    CHECK(during[category::timers].current > 0);
+#if XEQ_FRAME_ACCOUNTING
+    CHECK(during[category::frames].allocations >= 1);
+#endif
+
+    auto s = acct->get_snapshot();
+#if XEQ_FRAME_ACCOUNTING
+    CHECK(s[category::frames].allocations >= 2); // the leaves (the root frame was allocated outside of a handler)
+#endif
+    CHECK(s[category::handlers].allocations >= 5);
+    CHECK(s[category::handlers].peak > 0);
+    CHECK(s[category::timers].allocations >= 2); // the timer and its wait
+
+    // all released
+    CHECK(s.total.current == 0);
+    CHECK(s[category::frames].current == 0);
+    CHECK(s[category::handlers].current == 0);
+    CHECK(s[category::timers].current == 0);
+}
+
+namespace {
+coro<void> leaves(int& sum) {
+    sum += co_await leaf(1);
+    sum += co_await leaf(2);
+}
+}
+
+TEST_CASE("queued executor") {
+    context ctx;
+    auto ps = priority_scheduler::create(ctx);
+    auto& ex = ps->get_executor(0);
+    auto acct = std::make_shared<memory_account>();
+    ex->set_memory_account(acct);
+    CHECK(ex->make_strand()->get_memory_account() == acct);
+
+    int sum = 0;
+    co_spawn(ex, leaves(sum));
+    ctx.run();
+    CHECK(sum == 3);
+
+    // the queue nodes aren't charged, but the frames allocated by the handlers are
+    auto s = acct->get_snapshot();
+#if XEQ_FRAME_ACCOUNTING
+    CHECK(s[category::frames].allocations == 2);
+#endif
+    CHECK(s.total.current == 0);
+}
+
+TEST_CASE("soft limit") {
+    context ctx;
+    auto& acct = ctx.enable_memory_accounting();
+    int exceeded = 0;
+    acct->set_soft_limit(1000, [&](const memory_account&) { ++exceeded; });
+
+    auto& ex = ctx.get_executor();
+    int ran = 0;
+    for (int i = 0; i < 100; ++i) {
+        ex->post([&] { ++ran; });
+    }
+    CHECK(exceeded == 1); // the queued handlers went over the limit
+    CHECK(acct->get_snapshot()[category::handlers].current > 1000);
+
+    ctx.run();
+    CHECK(ran == 100);
+    CHECK(acct->get_snapshot().total.current == 0);
+
+    // after dropping below the limit, it can trigger again
+    for (int i = 0; i < 100; ++i) {
+        ex->post([&] { ++ran; });
+    }
+    CHECK(exceeded == 2);
+    ctx.restart();
+    ctx.run();
+}
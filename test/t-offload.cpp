@@ -0,0 +1,123 @@
+#include <xeq/offload.hpp>
+#include <xeq/co_execute.hpp>
+#include <doctest/doctest.h>
+#include <atomic>
+#include <latch>
+#include <string>
+#include <thread>
+
+using namespace xeq;
+
+coro<void> basic(offload_pool& pool) {
+    auto& ex = co_await this_coro::executor{};
+    const auto caller_thread = std::this_thread::get_id();
+
+    auto tid = co_await offload(pool, [] { return std::this_thread::get_id(); });
+    CHECK(tid != caller_thread);
+    CHECK(ex->running_in_this_thread());
+
+    auto str = co_await offload(pool, [] { return std::string("hello"); });
+    CHECK(str == "hello");
+
+    int n = 0;
+    co_await offload(pool, [&] { n = 5; });
+    CHECK(n == 5);
+
+    CHECK_THROWS_WITH(co_await offload(pool, []() -> int { throw std::runtime_error("boom"); }), "boom");
+
+    auto r = co_await offload(pool, [] { return 3; }).safe_result();
+    REQUIRE(r);
+    CHECK(*r == 3);
+
+    auto e = co_await offload(pool, []() -> int { throw std::runtime_error("safe"); }).safe_result();
+    CHECK_FALSE(e);
+
+    // default pool
+    auto d = co_await offload([] { return 10; });
+    CHECK(d == 10);
+}
+
+TEST_CASE("offload") {
+    auto pool = offload_pool::create({.num_threads = 2});
+    co_execute(basic(*pool));
+
+    auto stats = pool->get_stats();
+    CHECK(stats.submitted == 6);
+    CHECK(stats.completed == 6);
+    CHECK(stats.rejected == 0);
+    CHECK(stats.queued == 0);
+    CHECK(stats.active == 0);
+}
+
+namespace {
+// occupy the single pool thread until released
+struct blocker {
+    std::latch started{1};
+    std::latch release{1};
+    void block(offload_pool& pool) {
+        pool.submit([this] {
+            started.count_down();
+            release.wait();
+        });
+        started.wait();
+    }
+};
+
+coro<bool> rejected(offload_pool& pool) {
+    auto r = co_await offload(pool, [] { return 1; }).safe_result();
+    if (r) co_return false;
+    try {
+        std::rethrow_exception(r.error());
+    }
+    catch (offload_rejected&) {
+        co_return true;
+    }
+}
+
+coro<std::thread::id> inline_tid(offload_pool& pool) {
+    co_return co_await offload(pool, [] { return std::this_thread::get_id(); });
+}
+}
+
+TEST_CASE("overflow") {
+    {
+        blocker b; // outlives the pool
+        auto pool = offload_pool::create({.num_threads = 1, .max_queued = 1});
+        b.block(*pool);
+        pool->submit([] {}); // fill the queue
+
+        CHECK(co_execute(rejected(*pool)));
+
+        b.release.count_down();
+        auto stats = pool->get_stats();
+        CHECK(stats.rejected == 1);
+        CHECK(stats.peak_queued == 1);
+    }
+
+    {
+        blocker b;
+        auto pool = offload_pool::create({.num_threads = 1, .max_queued = 1, .on_overflow = offload_pool::overflow_policy::caller_runs});
+        b.block(*pool);
+        pool->submit([] {});
+
+        CHECK(co_execute(inline_tid(*pool)) == std::this_thread::get_id());
+
+        b.release.count_down();
+        auto stats = pool->get_stats();
+        CHECK(stats.ran_inline == 1);
+        CHECK(stats.rejected == 0);
+    }
+}
+
+TEST_CASE("throwing job") {
+    auto pool = offload_pool::create({.num_threads = 1});
+    pool->submit([] { throw std::runtime_error("job"); });
+
+    // the worker is still alive
+    std::latch done(1);
+    pool->submit([&] { done.count_down(); });
+    done.wait();
+
+    // a single worker finishes the jobs in order
+    CHECK(pool->get_stats().failed == 1);
+}
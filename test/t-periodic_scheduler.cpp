@@ -0,0 +1,97 @@
+#include <xeq/periodic_scheduler.hpp>
+#include <xeq/context.hpp>
+#include <doctest/doctest.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace xeq;
+using namespace std::chrono_literals;
+using time_point = periodic_scheduler::time_point;
+
+TEST_CASE("batching") {
+    context ctx;
+    auto sched = periodic_scheduler::create(ctx.make_strand());
+    CHECK_THROWS_WITH(sched->add(0ms, [](time_point) {}), "xeq::periodic_scheduler: period must be positive");
+
+    std::vector<time_point> a, b, c;
+    // jobs of a group run in the order in which they were added, so b runs before a clears them
+    sched->add(10ms, [&](time_point t) { b.push_back(t); }, periodic_scheduler::missed_ticks::catch_up);
+    sched->add(10ms, [&](time_point t) {
+        a.push_back(t);
+        if (a.size() == 10) sched->clear();
+    }, periodic_scheduler::missed_ticks::catch_up);
+    sched->add(20ms, [&](time_point t) { c.push_back(t); }, periodic_scheduler::missed_ticks::catch_up);
+    CHECK(sched->num_jobs() == 3);
+
+    ctx.run(); // returns when the jobs are cleared and the timer is no longer armed
+
+    CHECK(sched->num_jobs() == 0);
+    REQUIRE(a.size() == 10);
+
+    // no drift: the ticks are exactly one period apart
+    for (size_t i = 1; i < a.size(); ++i) {
+        CHECK(a[i] - a[i - 1] == 10ms);
+    }
+
+    // the same period shares the ticks and the longer period coincides with every other one of them
+    CHECK(b == a);
+    REQUIRE(c.size() >= 4);
+    for (auto& t : c) {
+        CHECK(std::find(a.begin(), a.end(), t) != a.end());
+    }
+
+    auto stats = sched->get_stats();
+    CHECK(stats.wakeups <= a.size());
+    CHECK(stats.skipped == 0);
+}
+
+TEST_CASE("missed ticks") {
+    context ctx;
+    auto sched = periodic_scheduler::create(ctx.make_strand());
+
+    std::vector<time_point> skip, catch_up;
+    sched->add(5ms, [&](time_point t) {
+        catch_up.push_back(t);
+        if (catch_up.size() == 1) {
+            // miss a few ticks
+            std::this_thread::sleep_for(23ms);
+        }
+        if (catch_up.size() == 8) sched->clear();
+    }, periodic_scheduler::missed_ticks::catch_up);
+    sched->add(5ms, [&](time_point t) { skip.push_back(t); });
+
+    ctx.run();
+
+    REQUIRE(catch_up.size() == 8);
+    for (size_t i = 1; i < catch_up.size(); ++i) {
+        CHECK(catch_up[i] - catch_up[i - 1] == 5ms);
+    }
+
+    REQUIRE(skip.size() >= 2);
+    CHECK(skip.size() < catch_up.size());
+    CHECK(skip[1] - skip[0] >= 20ms);
+    CHECK((skip[1] - skip[0]) % 5ms == 0ms);
+
+    auto stats = sched->get_stats();
+    CHECK(stats.skipped >= 3);
+}
+
+TEST_CASE("remove") {
+    context ctx;
+    auto sched = periodic_scheduler::create(ctx.get_executor());
+
+    int a = 0, b = 0;
+    periodic_scheduler::job_id ida = 0;
+    ida = sched->add(1ms, [&](time_point) {
+        if (++a == 3) sched->remove(ida);
+    });
+    sched->add(1ms, [&](time_point) {
+        if (++b == 6) sched->clear();
+    });
+    CHECK_FALSE(sched->remove(100));
+
+    ctx.run();
+    CHECK(a == 3);
+    CHECK(b == 6);
+}
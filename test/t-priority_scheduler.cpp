@@ -0,0 +1,82 @@
+#include <xeq/priority_scheduler.hpp>
+#include <xeq/context.hpp>
+#include <xeq/co_spawn.hpp>
+#include <xeq/timer_wobj.hpp>
+#include <doctest/doctest.h>
+#include <string>
+#include <vector>
+
+TEST_CASE("priority order") {
+    xeq::context ctx;
+    auto ps = xeq::priority_scheduler::create(ctx);
+    CHECK(ps->num_levels() == 3);
+
+    std::string order;
+    for (int i = 0; i < 3; ++i) {
+        ps->post(2, [&] { order += 'l'; });
+    }
+    ps->post(1, [&] { order += 'm'; });
+    ps->post(0, [&] {
+        order += 'h';
+        // posted from a handler: still goes before the queued lower levels
+        ps->post(0, [&] { order += 'H'; });
+    });
+    ctx.run();
+    CHECK(order == "hHmlll");
+
+    auto stats = ps->get_stats();
+    CHECK(stats.executed[0] == 2);
+    CHECK(stats.executed[1] == 1);
+    CHECK(stats.executed[2] == 3);
+    CHECK(stats.queued[2] == 0);
+}
+
+TEST_CASE("priority starvation") {
+    xeq::context ctx;
+    auto ps = xeq::priority_scheduler::create(ctx, {2, 4});
+
+    std::string order;
+    ps->post(1, [&] { order += 'l'; });
+    for (int i = 0; i < 10; ++i) {
+        ps->post(0, [&] { order += 'h'; });
+    }
+    ctx.run();
+    CHECK(order == "hhhhlhhhhhh");
+    CHECK(ps->get_stats().starvation_rescues[1] == 1);
+
+    CHECK_THROWS(xeq::priority_scheduler::create(ctx, {0, 4}));
+    CHECK_THROWS(xeq::priority_scheduler::create(ctx, {xeq::priority_scheduler::max_levels + 1, 4}));
+}
+
+TEST_CASE("priority coro and timers") {
+    xeq::context ctx;
+    auto ps = xeq::priority_scheduler::create(ctx);
+
+    auto strand = ps->make_strand(0);
+    CHECK(strand->is_strand());
+    CHECK(strand->get_super_executor() == ps->get_executor(0));
+
+    xeq::timer_wobj wobj(strand);
+    std::vector<int> log;
+
+    co_spawn(strand, [](xeq::priority_scheduler& ps, xeq::timer_wobj& w, std::vector<int>& log, xeq::strand_ptr s) -> xeq::coro<void> {
+        CHECK(s->running_in_this_thread());
+        log.push_back(1);
+        CHECK_FALSE(co_await w.wait(xeq::timeout::after_ms(1)));
+        CHECK(s->running_in_this_thread());
+        log.push_back(2);
+        ps.post(2, [&] {
+            log.push_back(11);
+            w.notify_one();
+        });
+        CHECK(co_await w.wait());
+        log.push_back(3);
+    }(*ps, wobj, log, strand));
+
+    ps->post(2, [&] {
+        log.push_back(10);
+    });
+
+    ctx.run();
+    CHECK(log == std::vector<int>{1, 10, 2, 11, 3});
+}
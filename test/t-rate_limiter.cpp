@@ -0,0 +1,137 @@
+#include <xeq/rate_limiter.hpp>
+#include <xeq/co_execute.hpp>
+#include <xeq/co_spawn.hpp>
+#include <xeq/context.hpp>
+#include <xeq/memory_account.hpp>
+#include <doctest/doctest.h>
+#include <limits>
+#include <vector>
+
+using namespace xeq;
+using namespace std::chrono_literals;
+
+TEST_CASE("config") {
+    context ctx;
+    CHECK_THROWS_WITH(rate_limiter::create(ctx.get_executor(), {.rate = 0}), "xeq::rate_limiter: rate must be positive");
+    CHECK_THROWS_WITH(rate_limiter::create(ctx.get_executor(), {.rate = 1, .burst = -1}), "xeq::rate_limiter: burst must be positive");
+    auto rl = rate_limiter::create(ctx.get_executor(), {.rate = 1, .burst = 3});
+    CHECK_THROWS_WITH(rl->acquire(4), "xeq::rate_limiter: can't acquire more than the burst");
+    for (double n : {0.0, -1.0, std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN()}) {
+        CHECK_THROWS_WITH(rl->acquire(n), "xeq::rate_limiter: tokens must be positive and finite");
+        CHECK_THROWS_WITH(rl->try_acquire(n), "xeq::rate_limiter: tokens must be positive and finite");
+    }
+    CHECK(rl->available() == 3);
+}
+
+TEST_CASE("try_acquire") {
+    context ctx;
+    // slow enough for the refill to not matter
+    auto rl = rate_limiter::create(ctx.get_executor(), {.rate = 0.001, .burst = 5});
+    CHECK(rl->available() == doctest::Approx(5).epsilon(0.01));
+    CHECK(rl->try_acquire(3));
+    CHECK(rl->try_acquire());
+    CHECK_FALSE(rl->try_acquire(2));
+    CHECK(rl->try_acquire());
+    CHECK_FALSE(rl->try_acquire());
+    CHECK(rl->num_waiters() == 0);
+}
+
+coro<void> throttled() {
+    auto& ex = co_await this_coro::executor{};
+    auto rl = rate_limiter::create(ex, {.rate = 1000, .burst = 5});
+
+    // the burst is available immediately
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 5; ++i) {
+        co_await rl->acquire();
+    }
+    CHECK(std::chrono::steady_clock::now() - start < 100ms);
+
+    // then 1 per ms
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 20; ++i) {
+        co_await rl->acquire();
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    CHECK(elapsed >= 15ms);
+    CHECK(elapsed < 1s);
+    CHECK(rl->num_waiters() == 0);
+}
+
+TEST_CASE("acquire") {
+    co_execute(throttled());
+}
+
+coro<void> acquire_and_record(rate_limiter& rl, double n, int id, std::vector<int>& order) {
+    co_await rl.acquire(n);
+    order.push_back(id);
+}
+
+TEST_CASE("fifo") {
+    context ctx;
+    auto rl = rate_limiter::create(ctx.get_executor(), {.rate = 200, .burst = 3});
+    REQUIRE(rl->try_acquire(3));
+
+    std::vector<int> order;
+    co_spawn(ctx, acquire_and_record(*rl, 3, 1, order)); // first in line
+    co_spawn(ctx, acquire_and_record(*rl, 1, 2, order)); // would be ready sooner, but must not overtake
+    co_spawn(ctx, acquire_and_record(*rl, 1, 3, order));
+    ctx.run();
+
+    CHECK(order == std::vector<int>{1, 2, 3});
+    CHECK(rl->num_waiters() == 0);
+}
+
+TEST_CASE("timer is released when idle") {
+    context ctx;
+    auto& acct = ctx.enable_memory_accounting();
+    auto rl = rate_limiter::create(ctx.get_executor(), {.rate = 1000, .burst = 1});
+    REQUIRE(rl->try_acquire());
+
+    std::vector<int> order;
+    co_spawn(ctx, acquire_and_record(*rl, 1, 1, order));
+    co_spawn(ctx, acquire_and_record(*rl, 1, 2, order));
+    ctx.run();
+
+    CHECK(order == std::vector<int>{1, 2});
+    const auto timers = acct->get_snapshot()[memory_account::category::timers];
+    CHECK(timers.allocations > 0); // it did wait
+    CHECK(timers.current == 0);
+}
+
+// nobody resumes an abandoned coroutine, so it gives out its handle to be destroyed
+struct self_handle {
+    std::coroutine_handle<> h;
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> self) noexcept {
+        h = self;
+        return false;
+    }
+    std::coroutine_handle<> await_resume() const noexcept { return h; }
+};
+
+coro<void> abandoned_acquire(rate_limiter& rl, std::coroutine_handle<>& self, bool& acquired) {
+    self = co_await self_handle{};
+    co_await rl.acquire();
+    acquired = true;
+}
+
+TEST_CASE("abandoned wait") {
+    std::weak_ptr<rate_limiter> weak;
+    std::coroutine_handle<> waiter;
+    bool acquired = false;
+    {
+        context ctx;
+        auto rl = rate_limiter::create(ctx.get_executor(), {.rate = 0.001, .burst = 1});
+        REQUIRE(rl->try_acquire());
+        co_spawn(ctx, abandoned_acquire(*rl, waiter, acquired));
+        ctx.poll();
+        CHECK(rl->num_waiters() == 1);
+        weak = rl;
+    }
+    // the context was destroyed with the wait pending, which doesn't keep the limiter alive
+    CHECK(weak.expired());
+    CHECK_FALSE(acquired);
+    REQUIRE(waiter);
+    waiter.destroy();
+}
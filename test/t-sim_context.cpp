@@ -0,0 +1,118 @@
+#include <xeq/sim_context.hpp>
+#include <xeq/co_spawn.hpp>
+#include <xeq/executor.hpp>
+#include <xeq/timer_wobj.hpp>
+#include <doctest/doctest.h>
+#include <chrono>
+#include <vector>
+
+using namespace xeq;
+using namespace std::chrono_literals;
+
+namespace {
+coro<void> session(timer_wobj& wobj, bool& notified) {
+    notified = co_await wobj.wait(timeout::after(10min));
+}
+}
+
+TEST_CASE("virtual time") {
+    sim_context sim;
+    const auto start = sim.now();
+    auto strand = sim.make_strand();
+
+    timer_wobj wobj(strand);
+    bool notified = true;
+
+    const auto wall_start = std::chrono::steady_clock::now();
+    co_spawn(strand, session(wobj, notified));
+    sim.run();
+    CHECK(std::chrono::steady_clock::now() - wall_start < 1s);
+
+    CHECK_FALSE(notified); // timed out
+    CHECK(sim.now() - start == 10min);
+
+    // notify before the timeout
+    co_spawn(strand, session(wobj, notified));
+    sim.run_for(3min);
+    CHECK(sim.now() - start == 13min);
+    wobj.notify_one();
+    sim.run();
+    CHECK(notified);
+    CHECK(sim.now() - start == 13min);
+}
+
+TEST_CASE("timers") {
+    sim_context sim;
+    auto ex = sim.get_executor();
+    auto t1 = timer::create(ex);
+    auto t2 = timer::create(ex);
+    auto t3 = timer::create(ex);
+
+    std::vector<int> fired;
+    std::vector<sim_context::time_point> at;
+    auto cb = [&](int i) {
+        return [&, i](const error_code& ec) {
+            fired.push_back(ec ? -i : i);
+            at.push_back(sim.now());
+        };
+    };
+
+    t1->expire_after(5s);
+    t1->add_wait_cb(cb(1));
+    t2->expire_after(2s);
+    t2->add_wait_cb(cb(2));
+    t3->expire_after(7s);
+    t3->add_wait_cb(cb(3));
+
+    sim.run_until(sim.now() + 6s);
+    CHECK(fired == std::vector<int>{2, 1});
+    CHECK(at[0] == sim_context::time_point{} + 2s);
+    CHECK(at[1] == sim_context::time_point{} + 5s);
+    CHECK(sim.now() == sim_context::time_point{} + 6s);
+
+    CHECK(t3->cancel() == 1);
+    sim.run();
+    CHECK(fired == std::vector<int>{2, 1, -3});
+    CHECK(sim.now() == sim_context::time_point{} + 6s);
+
+    // waiting on an expired timer completes right away
+    t1->add_wait_cb(cb(4));
+    sim.poll();
+    CHECK(fired.back() == 4);
+}
+
+namespace {
+std::vector<int> interleave(uint64_t seed) {
+    sim_context sim(seed);
+    std::vector<int> out;
+    auto s1 = sim.make_strand();
+    auto s2 = sim.make_strand();
+    for (int i = 0; i < 20; ++i) {
+        s1->post([&out, i] { out.push_back(i); });
+        s2->post([&out, i] { out.push_back(100 + i); });
+        sim.get_executor()->post([&out, i] { out.push_back(200 + i); });
+    }
+    sim.run();
+    return out;
+}
+}
+
+TEST_CASE("reproducible order") {
+    auto a = interleave(1);
+    REQUIRE(a.size() == 60);
+    CHECK(a == interleave(1));
+    CHECK(a != interleave(2));
+
+    // strands keep their order
+    int last1 = -1, last2 = 99;
+    for (auto i : a) {
+        if (i < 100) {
+            CHECK(i == last1 + 1);
+            last1 = i;
+        }
+        else if (i < 200) {
+            CHECK(i == last2 + 1);
+            last2 = i;
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#include <xeq/spsc_channel.hpp>
+#include <xeq/context.hpp>
+#include <xeq/co_spawn.hpp>
+#include <xeq/executor.hpp>
+#include <doctest/doctest.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace xeq;
+
+TEST_CASE("ring") {
+    context ctx;
+    spsc_channel<std::unique_ptr<int>> ch(ctx.make_strand(), 5);
+    CHECK(ch.capacity() == 8);
+
+    CHECK_FALSE(ch.try_pop());
+
+    for (int i = 0; i < 8; ++i) {
+        CHECK(ch.try_push(std::make_unique<int>(i)));
+    }
+    CHECK_FALSE(ch.try_push(std::make_unique<int>(100)));
+
+    auto v = ch.try_pop();
+    REQUIRE(v);
+    CHECK(**v == 0);
+
+    std::vector<std::unique_ptr<int>> batch;
+    for (int i = 8; i < 12; ++i) {
+        batch.push_back(std::make_unique<int>(i));
+    }
+    auto rest = ch.try_push_n(batch.begin(), batch.end());
+    CHECK(rest - batch.begin() == 1); // only one slot was free
+
+    std::vector<std::unique_ptr<int>> out;
+    CHECK(ch.try_pop_n(std::back_inserter(out), 5) == 5);
+    CHECK(ch.try_pop_n(std::back_inserter(out), 5) == 3);
+    CHECK(ch.try_pop_n(std::back_inserter(out), 5) == 0);
+    REQUIRE(out.size() == 8);
+    for (int i = 0; i < 8; ++i) {
+        CHECK(*out[i] == i + 1);
+    }
+
+    rest = ch.try_push_n(rest, batch.end());
+    CHECK(rest == batch.end());
+    v = ch.try_pop();
+    REQUIRE(v);
+    CHECK(**v == 9);
+}
+
+namespace {
+coro<void> consume(spsc_channel<int>& ch, std::vector<int>& out, int& waits, work_guard& wg) {
+    std::vector<int> batch;
+    while (co_await ch.wait()) {
+        ++waits;
+        batch.clear();
+        ch.try_pop_n(std::back_inserter(batch), 16);
+        out.insert(out.end(), batch.begin(), batch.end());
+    }
+    wg.reset();
+}
+}
+
+TEST_CASE("wake") {
+    context ctx;
+    auto strand = ctx.make_strand();
+    spsc_channel<int> ch(strand, 64);
+
+    std::vector<int> out;
+    int waits = 0;
+    auto wg = ctx.make_work_guard();
+    co_spawn(strand, consume(ch, out, waits, wg));
+    ctx.poll(); // park the consumer
+    CHECK(waits == 0);
+
+    constexpr int n = 100'000;
+    std::thread producer([&] {
+        for (int i = 0; i < n;) {
+            if (ch.try_push(i)) ++i;
+            else std::this_thread::yield();
+        }
+        ch.close();
+    });
+
+    ctx.restart();
+    ctx.run();
+    producer.join();
+
+    REQUIRE(out.size() == n);
+    for (int i = 0; i < n; ++i) {
+        if (out[i] != i) {
+            CHECK(out[i] == i);
+            break;
+        }
+    }
+    CHECK(waits > 0);
+}
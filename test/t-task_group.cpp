@@ -0,0 +1,114 @@
+#include <xeq/task_group.hpp>
+#include <xeq/offload.hpp>
+#include <xeq/co_execute.hpp>
+#include <doctest/doctest.h>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace xeq;
+
+namespace {
+struct concurrency {
+    int current = 0;
+    int max = 0;
+    int done = 0;
+};
+
+coro<void> child(offload_pool& pool, concurrency& c) {
+    ++c.current;
+    c.max = std::max(c.max, c.current);
+    co_await offload(pool, [] { std::this_thread::sleep_for(std::chrono::milliseconds(1)); });
+    --c.current;
+    ++c.done;
+}
+
+coro<void> failing(offload_pool& pool) {
+    co_await offload(pool, [] {});
+    throw std::runtime_error("child failed");
+}
+
+coro<void> unbounded(offload_pool& pool) {
+    auto& ex = co_await this_coro::executor{};
+    task_group group;
+    concurrency c;
+    for (int i = 0; i < 10; ++i) {
+        group.spawn(ex, child(pool, c));
+    }
+    co_await group.join();
+    CHECK(c.done == 10);
+    CHECK(c.current == 0);
+    CHECK(group.num_running() == 0);
+    CHECK_FALSE(group.cancelled());
+
+    // nothing to join
+    task_group empty;
+    co_await empty.join();
+}
+
+coro<void> bounded(offload_pool& pool) {
+    auto& ex = co_await this_coro::executor{};
+    task_group group(3);
+    concurrency c;
+    for (int i = 0; i < 20; ++i) {
+        group.spawn(ex, child(pool, c));
+    }
+    CHECK(group.num_running() == 3);
+    CHECK(group.num_queued() == 17);
+    co_await group.join();
+    CHECK(c.done == 20);
+    CHECK(c.max == 3);
+}
+
+coro<void> slots(offload_pool& pool) {
+    auto& ex = co_await this_coro::executor{};
+    task_group group(4);
+    concurrency c;
+    size_t max_queued = 0;
+    for (int i = 0; i < 30; ++i) {
+        co_await group.wait_for_slot();
+        group.spawn(ex, child(pool, c));
+        max_queued = std::max(max_queued, group.num_queued());
+    }
+    co_await group.join();
+    CHECK(c.done == 30);
+    CHECK(c.max <= 4);
+    CHECK(max_queued == 0);
+}
+
+coro<void> error(offload_pool& pool) {
+    auto& ex = co_await this_coro::executor{};
+    task_group group(2);
+    concurrency c;
+    group.spawn(ex, failing(pool));
+    for (int i = 0; i < 10; ++i) {
+        group.spawn(ex, child(pool, c));
+    }
+    std::string err;
+    try {
+        co_await group.join();
+    }
+    catch (std::exception& e) {
+        err = e.what();
+    }
+    CHECK(err == "child failed");
+    CHECK(group.cancelled());
+    CHECK(group.num_queued() == 0);
+    CHECK(c.done < 10); // the queued ones were dropped
+
+    // spawns after a cancel are ignored
+    group.spawn(ex, child(pool, c));
+    CHECK(group.num_running() == 0);
+    CHECK(group.num_queued() == 0);
+}
+}
+
+TEST_CASE("task_group") {
+    auto pool = offload_pool::create({.num_threads = 2});
+    co_execute(unbounded(*pool));
+    co_execute(bounded(*pool));
+    co_execute(slots(*pool));
+    co_execute(error(*pool));
+}
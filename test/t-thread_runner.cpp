@@ -1,6 +1,10 @@
 #include <xeq/thread_runner.hpp>
+#include <xeq/elastic_thread_runner.hpp>
+#include <xeq/context.hpp>
+#include <xeq/executor.hpp>
 #include <doctest/doctest.h>
 #include <atomic>
+#include <thread>
 
 struct fake_ctx {
     std::atomic_int32_t m_counter = 0;
@@ -43,3 +47,121 @@ TEST_CASE("multi thread runner start/stop") {
     CHECK(runner.num_threads() == 0);
     CHECK(runner.empty());
 }
+
+// the elastic runner reacts to timing, so the tests don't depend on how long anything takes:
+// the load is made with handlers which block until they are released, the thresholds are far from
+// what scheduling noise could cause, and the expected thread counts are polled for with a generous deadline
+template <typename Pred>
+bool wait_for(Pred pred) {
+    using namespace std::chrono_literals;
+    const auto deadline = std::chrono::steady_clock::now() + 20s;
+    while (!pred()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(1ms);
+    }
+    return true;
+}
+
+// occupies n threads of the context until released
+struct blocker {
+    std::atomic_bool released = false;
+    std::atomic_int running = 0;
+    std::atomic_int done = 0;
+
+    void block(xeq::context& ctx, int n) {
+        for (int i = 0; i < n; ++i) {
+            ctx.get_executor()->post([this] {
+                ++running;
+                while (!released) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                ++done;
+            });
+        }
+    }
+};
+
+TEST_CASE("elastic thread runner") {
+    using namespace std::chrono_literals;
+    xeq::context ctx;
+    auto wg = ctx.make_work_guard();
+
+    std::atomic_size_t spawn_cbs = 0, retire_cbs = 0;
+
+    xeq::elastic_thread_runner::config cfg;
+    cfg.min_threads = 1;
+    cfg.max_threads = 4;
+    cfg.probe_interval = 1ms;
+    cfg.spawn_latency = 20ms;
+    cfg.spawn_after = 2;
+    cfg.idle_latency = 50ms;
+    cfg.idle_period = 10ms;
+    cfg.name = "elastic";
+    cfg.on_spawn = [&](size_t) { ++spawn_cbs; };
+    cfg.on_retire = [&](size_t) { ++retire_cbs; };
+
+    xeq::elastic_thread_runner runner(ctx, std::move(cfg));
+    CHECK(runner.num_threads() == 1);
+
+    // saturate: the probe can't run, so its latency grows until all workers are spawned
+    blocker b;
+    b.block(ctx, 4);
+    CHECK(wait_for([&] { return runner.num_threads() == 4; }));
+    CHECK(wait_for([&] { return b.running == 4; }));
+    b.released = true;
+    CHECK(wait_for([&] { return b.done == 4; }));
+
+    // the stalled probe runs eventually
+    CHECK(wait_for([&] { return runner.get_stats().max_probe_latency >= 20ms; }));
+    auto stats = runner.get_stats();
+    CHECK(stats.spawned == 3);
+    CHECK(stats.spawned == spawn_cbs);
+    CHECK(stats.probes > 0);
+
+    // idle down to min
+    CHECK(wait_for([&] { return runner.num_threads() == 1; }));
+    stats = runner.get_stats();
+    CHECK(stats.retired == retire_cbs);
+    CHECK(stats.retired == stats.spawned);
+
+    wg.reset();
+    runner.join();
+    CHECK(runner.empty());
+}
+
+TEST_CASE("elastic thread runner with a foreign thread") {
+    // a user thread runs the context too, so it may execute retire handlers
+    // only the retirements of workers are counted
+    using namespace std::chrono_literals;
+    xeq::context ctx;
+    auto wg = ctx.make_work_guard();
+    std::thread user([&] { ctx.run(); });
+
+    xeq::elastic_thread_runner::config cfg;
+    cfg.min_threads = 0;
+    cfg.max_threads = 1;
+    cfg.probe_interval = 1ms;
+    cfg.spawn_latency = 20ms;
+    cfg.spawn_after = 2;
+    cfg.idle_latency = 50ms;
+    cfg.idle_period = 5ms;
+
+    xeq::elastic_thread_runner runner(ctx, std::move(cfg));
+    CHECK(runner.num_threads() == 0);
+
+    // the user thread and the worker
+    blocker b;
+    b.block(ctx, 2);
+    CHECK(wait_for([&] { return runner.num_threads() == 1; }));
+    b.released = true;
+    CHECK(wait_for([&] { return b.done == 2; }));
+
+    CHECK(wait_for([&] { return runner.num_threads() == 0; }));
+    auto stats = runner.get_stats();
+    CHECK(stats.spawned == 1);
+    CHECK(stats.retired == stats.spawned);
+
+    wg.reset();
+    runner.join();
+    user.join();
+}
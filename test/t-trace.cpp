@@ -0,0 +1,142 @@
+#include <xeq/trace.hpp>
+#include <xeq/context.hpp>
+#include <xeq/executor.hpp>
+#include <doctest/doctest.h>
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace xeq;
+
+namespace {
+size_t count(const std::string& str, std::string_view sub) {
+    size_t ret = 0;
+    for (auto p = str.find(sub); p != std::string::npos; p = str.find(sub, p + 1)) {
+        ++ret;
+    }
+    return ret;
+}
+
+std::string flush(size_t& num_events) {
+    std::ostringstream out;
+    num_events = trace::write_chrome_trace(out);
+    return out.str();
+}
+}
+
+TEST_CASE("trace") {
+    size_t n;
+    flush(n); // drop whatever is there
+
+    context ctx;
+    auto strand = ctx.make_strand();
+
+    // disabled
+    CHECK_FALSE(trace::enabled());
+    ctx.get_executor()->post([] {});
+    ctx.run();
+    ctx.restart();
+    flush(n);
+    CHECK(n == 0);
+
+    trace::start();
+    CHECK(trace::enabled());
+    {
+        trace::scoped_label l("parent");
+        strand->post([&] {
+            // inherited label
+            ctx.get_executor()->post([] {});
+            trace::scoped_label l2("child");
+            strand->post([] {});
+        });
+    }
+    ctx.get_executor()->post([] {});
+    ctx.run();
+    ctx.restart();
+    trace::stop();
+
+    auto json = flush(n);
+    CHECK(n == 12); // 4 tasks x post, start, end
+    CHECK(json.starts_with("{\"traceEvents\":["));
+    CHECK(count(json, R"("ph":"s")") == 4);
+    CHECK(count(json, R"("ph":"f")") == 4);
+    CHECK(count(json, R"("ph":"B")") == 4);
+    CHECK(count(json, R"("ph":"E")") == 4);
+    CHECK(count(json, R"("name":"parent","ph":"B")") == 2);
+    CHECK(count(json, R"("name":"child","ph":"B")") == 1);
+    CHECK(count(json, R"("name":"task","ph":"B")") == 1);
+
+    // drained
+    flush(n);
+    CHECK(n == 0);
+}
+
+TEST_CASE("full ring") {
+    size_t n;
+    std::thread([&] {
+        trace::start(4);
+        const auto dropped = trace::dropped_events();
+        context ctx;
+        for (int i = 0; i < 10; ++i) {
+            ctx.get_executor()->post([] {});
+        }
+        trace::stop();
+        ctx.run();
+        flush(n);
+        CHECK(n == 4);
+        CHECK(trace::dropped_events() - dropped == 6 + 20);
+    }).join();
+}
+
+TEST_CASE("escape") {
+    size_t n;
+    flush(n);
+
+    context ctx;
+    trace::start();
+    {
+        trace::scoped_label l("a\"b\\c\n\x01");
+        ctx.get_executor()->post([] {});
+    }
+    ctx.run();
+    trace::stop();
+
+    auto json = flush(n);
+    CHECK(n == 3);
+    CHECK(count(json, R"("name":"a\"b\\c\u000a\u0001","ph":"B")") == 1);
+}
+
+TEST_CASE("concurrent flush") {
+    size_t n;
+    flush(n);
+
+    constexpr size_t num_tasks = 10'000;
+    std::atomic_bool done = false;
+    std::atomic_size_t flushed = 0;
+    auto flusher = [&] {
+        while (!done) {
+            size_t fn;
+            flush(fn);
+            flushed += fn;
+        }
+    };
+
+    trace::start(num_tasks * 3);
+    std::thread a(flusher), b(flusher);
+    std::thread([&] {
+        context ctx;
+        for (size_t i = 0; i < num_tasks; ++i) {
+            ctx.get_executor()->post([] {});
+        }
+        ctx.run();
+    }).join();
+    trace::stop();
+    done = true;
+    a.join();
+    b.join();
+    flush(n);
+
+    // every event is written exactly once
+    CHECK(flushed + n == num_tasks * 3);
+}
@@ -0,0 +1,116 @@
+#include <xeq/typed_executor.hpp>
+#include <xeq/context.hpp>
+#include <xeq/co_spawn.hpp>
+#include <xeq/executor.hpp>
+#include <xeq/executor_bounds.hpp>
+#include <xeq/simple_wobj.hpp>
+#include <xeq/timer_wobj.hpp>
+#include <doctest/doctest.h>
+#include <vector>
+
+// the executor_ptr wobjs are still classes which user code can forward declare
+namespace xeq {
+class simple_wobj;
+class timer_wobj;
+}
+
+using namespace xeq;
+
+namespace {
+coro<void> record(std::vector<int>& log, int i, bool& on_strand, const strand_ptr& s) {
+    on_strand = s->running_in_this_thread();
+    auto& ex = co_await this_coro::executor{};
+    CHECK(ex == s);
+    log.push_back(i);
+}
+}
+
+TEST_CASE("context_executor_ref") {
+    context ctx;
+    context_executor_ref ex(ctx);
+    CHECK(ex.get_executor() == ctx.get_executor());
+    CHECK_FALSE(ex.running_in_this_thread());
+
+    std::vector<int> log;
+    post(ex, [&] {
+        CHECK(ex.running_in_this_thread());
+        log.push_back(1);
+    });
+    post(ctx.get_executor(), [&] { log.push_back(2); });
+    ctx.run();
+    CHECK(log == std::vector<int>{1, 2});
+
+    // same executor: bounds apply
+    auto b = executor_bounds::create({.capacity = 10});
+    ctx.get_executor()->set_bounds(b);
+    ex.post([] {});
+    CHECK(b->depth() == 1);
+    ctx.restart();
+    ctx.run();
+    CHECK(b->depth() == 0);
+}
+
+TEST_CASE("context_strand") {
+    context ctx;
+    context_strand strand(ctx);
+    REQUIRE(strand.get_executor());
+    CHECK(strand.get_executor()->is_strand());
+
+    std::vector<int> log;
+    bool on_strand[3] = {};
+    for (int i = 0; i < 3; ++i) {
+        co_spawn(strand, record(log, i, on_strand[i], strand.get_executor()));
+    }
+    ctx.run();
+    CHECK(log == std::vector<int>{0, 1, 2});
+    CHECK(on_strand[0]);
+    CHECK(on_strand[1]);
+    CHECK(on_strand[2]);
+
+    // typed and type-erased posts go to the same strand
+    log.clear();
+    post(strand, [&] { log.push_back(1); });
+    post(strand.get_executor(), [&] { log.push_back(2); });
+    strand.post_call([](void* l) { static_cast<std::vector<int>*>(l)->push_back(3); }, &log);
+    ctx.restart();
+    ctx.run();
+    CHECK(log == std::vector<int>{1, 2, 3});
+}
+
+namespace {
+coro<void> wait_and_log(basic_simple_wobj<context_strand>& wobj, std::vector<int>& log) {
+    log.push_back(1);
+    co_await wobj.wait();
+    log.push_back(3);
+}
+
+coro<void> timeout_and_log(basic_timer_wobj<context_strand>& wobj, std::vector<int>& log) {
+    auto w = wobj.wait(timeout::after_ms(1));
+    auto cancelled = co_await w;
+    log.push_back(cancelled ? -1 : 10);
+}
+}
+
+TEST_CASE("typed wobjs") {
+    context ctx;
+    context_strand strand(ctx);
+
+    std::vector<int> log;
+    basic_simple_wobj wobj(strand);
+    CHECK(wobj.get_executor() == strand.get_executor());
+    co_spawn(strand, wait_and_log(wobj, log));
+    post(strand, [&] {
+        log.push_back(2);
+        wobj.notify_one();
+    });
+    ctx.run();
+    CHECK(log == std::vector<int>{1, 2, 3});
+
+    log.clear();
+    basic_timer_wobj twobj(strand);
+    CHECK(twobj.get_executor() == strand.get_executor());
+    co_spawn(strand, timeout_and_log(twobj, log));
+    ctx.restart();
+    ctx.run();
+    CHECK(log == std::vector<int>{10});
+}
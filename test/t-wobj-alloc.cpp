@@ -0,0 +1,112 @@
+#include <xeq/timer_wobj.hpp>
+#include <xeq/simple_wobj.hpp>
+#include <xeq/context.hpp>
+#include <xeq/co_spawn.hpp>
+#include <xeq/executor.hpp>
+#include <doctest/doctest.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// count all heap allocations in this executable
+#if defined(__GNUC__) && !defined(__clang__)
+// gcc sees through the inlined replacements and flags new/free pairs
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+namespace {
+std::atomic_size_t g_allocations;
+}
+
+void* operator new(std::size_t size) {
+    ++g_allocations;
+    if (auto p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+using namespace xeq;
+
+namespace {
+constexpr int warmup = 10; // the first waits fill the handler allocator cache
+constexpr int measured = 100;
+
+// awaiting the wobjs must not allocate
+// the frame of the waiting coroutine is allocated before the counting starts
+// and checks are done after it ends (doctest may allocate)
+
+struct wait_counts {
+    size_t allocations = 1;
+    int notified = 0;
+    int timed_out = 0;
+};
+
+coro<void> timer_waits(wait_counts& counts) {
+    auto& ex = co_await this_coro::executor{};
+    timer_wobj wobj(ex);
+    size_t start = 0;
+    for (int i = 0; i < warmup + measured; ++i) {
+        if (i == warmup) start = g_allocations;
+
+        auto notified = co_await wobj.wait(timeout::now());
+        ++(notified ? counts.notified : counts.timed_out);
+
+        wobj.notify_one();
+        notified = co_await wobj.wait();
+        ++(notified ? counts.notified : counts.timed_out);
+
+        wobj.notify_one();
+        notified = co_await wobj.wait(timeout::after_ms(10'000));
+        ++(notified ? counts.notified : counts.timed_out);
+    }
+    counts.allocations = g_allocations - start;
+}
+
+coro<void> simple_waits(wait_counts& counts) {
+    auto& ex = co_await this_coro::executor{};
+    simple_wobj wobj(ex);
+    size_t start = 0;
+    for (int i = 0; i < warmup + measured; ++i) {
+        if (i == warmup) start = g_allocations;
+
+        wobj.notify_one();
+        auto notified = co_await wobj.wait();
+        ++(notified ? counts.notified : counts.timed_out);
+    }
+    counts.allocations = g_allocations - start;
+}
+}
+
+TEST_CASE("timer_wobj") {
+    context ctx;
+    wait_counts counts;
+    co_spawn(ctx.make_strand(), timer_waits(counts));
+    ctx.run();
+    CHECK(counts.allocations == 0);
+    CHECK(counts.notified == 2 * (warmup + measured));
+    CHECK(counts.timed_out == warmup + measured);
+}
+
+TEST_CASE("simple_wobj") {
+    context ctx;
+    {
+        wait_counts counts;
+        co_spawn(ctx.get_executor(), simple_waits(counts));
+        ctx.run();
+        CHECK(counts.allocations == 0);
+        CHECK(counts.notified == warmup + measured);
+    }
+    {
+        wait_counts counts;
+        co_spawn(ctx.make_strand(), simple_waits(counts));
+        ctx.restart();
+        ctx.run();
+        CHECK(counts.allocations == 0);
+        CHECK(counts.notified == warmup + measured);
+    }
+}